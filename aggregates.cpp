@@ -0,0 +1,109 @@
+#include "aggregates.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+struct Partial {
+    double sum = 0.0;
+    double sumSq = 0.0;
+    qint64 count = 0;
+
+    void scan(const RawSample *data, qsizetype n, double shift) {
+        for (qsizetype i = 0; i < n; ++i) {
+            const double v = data[i];
+            if (v != v) continue;
+            const double d = v - shift;
+            sum += d;
+            sumSq += d * d;
+            ++count;
+        }
+    }
+
+    void scan(const SampleColumn &column, qsizetype from, qsizetype to, double shift) {
+        column.forEachSpan(from, to, [this, shift](const RawSample *data, qsizetype, qsizetype n) {
+            scan(data, n, shift);
+        });
+    }
+};
+
+} // namespace
+
+void ChannelAggregates::clear() {
+    m_sum.clear();
+    m_sumSq.clear();
+    m_count.clear();
+}
+
+void ChannelAggregates::build(const SampleColumn &data, qsizetype count, double shift) {
+    clear();
+    m_shift = std::isfinite(shift) ? shift : 0.0;
+    extend(data, 0, count);
+}
+
+void ChannelAggregates::extend(const SampleColumn &data, qsizetype oldCount, qsizetype count) {
+    Q_UNUSED(oldCount); // префиксы есть только по полным блокам - продолжаем с последнего
+    if (m_sum.isEmpty()) {
+        m_sum.append(0.0);
+        m_sumSq.append(0.0);
+        m_count.append(0);
+    }
+
+    const qsizetype fullBlocks = count / kBlock;
+    const qsizetype firstBlock = m_sum.size() - 1;
+    if (firstBlock >= fullBlocks) return;
+
+    // Один проход по непрерывным кускам колонки; блок может попасть на стык кусков
+    Partial block;
+    qsizetype blockEnd = (firstBlock + 1) * kBlock;
+    data.forEachSpan(firstBlock * kBlock, fullBlocks * kBlock, [&](const RawSample *p, qsizetype first, qsizetype n) {
+        for (qsizetype i = first; i < first + n;) {
+            const qsizetype to = std::min(blockEnd, first + n);
+            block.scan(p + (i - first), to - i, m_shift);
+            i = to;
+            if (i == blockEnd) {
+                m_sum.append(m_sum.last() + block.sum);
+                m_sumSq.append(m_sumSq.last() + block.sumSq);
+                m_count.append(m_count.last() + block.count);
+                block = Partial();
+                blockEnd += kBlock;
+            }
+        }
+    });
+}
+
+WindowStats ChannelAggregates::query(const SampleColumn &data, const LodPyramid &lod, qsizetype from,
+                                     qsizetype to) const {
+    WindowStats stats;
+    if (to <= from || m_sum.isEmpty()) return stats;
+
+    // Полные блоки внутри [from, to) - из префиксов, края - прямым проходом
+    const qsizetype fullBlocks = m_sum.size() - 1;
+    const qsizetype firstBlock = std::min((from + kBlock - 1) / kBlock, fullBlocks);
+    const qsizetype lastBlock = std::min(to / kBlock, fullBlocks);
+
+    Partial p;
+    if (firstBlock >= lastBlock) {
+        p.scan(data, from, to, m_shift);
+    } else {
+        p.scan(data, from, firstBlock * kBlock, m_shift);
+        p.scan(data, lastBlock * kBlock, to, m_shift);
+        p.sum += m_sum[lastBlock] - m_sum[firstBlock];
+        p.sumSq += m_sumSq[lastBlock] - m_sumSq[firstBlock];
+        p.count += m_count[lastBlock] - m_count[firstBlock];
+    }
+    if (p.count == 0) return stats;
+
+    const double meanShifted = p.sum / p.count;
+    stats.count = p.count;
+    stats.mean = m_shift + meanShifted;
+    stats.stddev = std::sqrt(std::max(0.0, p.sumSq / p.count - meanShifted * meanShifted));
+
+    const LodPyramid::Bucket range = lod.range(data, from, to);
+    if (range.minIndex != LodPyramid::kNoIndex) {
+        stats.min = data[range.minIndex];
+        stats.max = data[range.maxIndex];
+    }
+    return stats;
+}
@@ -0,0 +1,42 @@
+#ifndef AGGREGATES_H
+#define AGGREGATES_H
+
+#include <QVector>
+
+#include "lodpyramid.h"
+
+// Статистика канала на интервале отсчетов
+struct WindowStats {
+    qsizetype count = 0; // отсчетов без пропусков
+    double mean = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+};
+
+// Префиксные суммы канала по блокам kBlock отсчетов: сумма, сумма квадратов
+// и число отсчетов без пропусков. Сумма по любому интервалу - разность двух
+// префиксов плюс досчет неполных крайних блоков (не больше 2 * kBlock отсчетов),
+// min/max - по LodPyramid того же канала. Значения хранятся со сдвигом на
+// среднее канала, иначе дисперсия через E[x^2] - E[x]^2 теряет точность.
+class ChannelAggregates
+{
+public:
+    static constexpr qsizetype kBlock = LodPyramid::kBaseBucket;
+
+    void build(const SampleColumn &data, qsizetype count, double shift);
+    // Колонка выросла с oldCount до count (слежение за файлом)
+    void extend(const SampleColumn &data, qsizetype oldCount, qsizetype count);
+    void clear();
+
+    WindowStats query(const SampleColumn &data, const LodPyramid &lod, qsizetype from, qsizetype to) const;
+
+private:
+    double m_shift = 0.0;
+    // [b] - по полным блокам до b-го; размер = число полных блоков + 1
+    QVector<double> m_sum;
+    QVector<double> m_sumSq;
+    QVector<qint64> m_count;
+};
+
+#endif // AGGREGATES_H
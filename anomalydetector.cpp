@@ -0,0 +1,79 @@
+#include "anomalydetector.h"
+#include "sensordata.h"
+
+void ChannelMonitor::merge(const ChannelMonitor &next) {
+    if (next.samples == 0) {
+        pendingGaps += next.pendingGaps;
+        return;
+    }
+    if (samples == 0) {
+        const qint64 lead = pendingGaps + next.leadingGaps;
+        *this = next;
+        leadingGaps = lead;
+        return;
+    }
+
+    const qint64 between = pendingGaps + next.leadingGaps;
+    gaps += between + next.gaps;
+    longestGap = std::max({longestGap, between, next.longestGap});
+    pendingGaps = next.pendingGaps;
+
+    // Серия на стыке: хвост этого монитора + начало следующего
+    const bool joined = (tailValue == next.headValue);
+    const qint64 across = joined ? tailRun + next.headRun : 0;
+    if (joined && tailValue != 0.0) longestRun = std::max(longestRun, across);
+    longestRun = std::max(longestRun, next.longestRun);
+    if (joined && headRun == samples) headRun += next.headRun;
+    if (joined && next.tailRun == next.samples) {
+        tailRun += next.samples;
+    } else {
+        tailValue = next.tailValue;
+        tailRun = next.tailRun;
+    }
+
+    if (next.max > max) {
+        max = next.max;
+        atMax = next.atMax;
+    } else if (next.max == max) {
+        atMax += next.atMax;
+    }
+
+    // Оценка выбросов продолжается с состояния следующего куска
+    judged += next.judged;
+    spikes += next.spikes;
+    median = next.median;
+    mad = next.mad;
+    warm = next.warm;
+    candidate = next.candidate;
+
+    samples += next.samples;
+}
+
+quint32 ChannelMonitor::flags(const AnomalyOptions &options) const {
+    if (samples == 0) return 0;
+    quint32 result = 0;
+    // Весь канал одним значением - мертвый, даже если это ноль
+    const bool constant = (headRun == samples);
+    if (constant || longestRun >= options.flatRun) result |= AnomalyFlat;
+    if (!constant && double(atMax) >= options.saturationShare * double(samples) && atMax > 1)
+        result |= AnomalySaturated;
+    if (judged > 0 && double(spikes) >= options.spikeShare * double(judged) && spikes > 1)
+        result |= AnomalySpikes;
+    if (double(gaps) >= options.dropoutShare * double(samples + gaps) || longestGap >= options.dropoutRun)
+        result |= AnomalyDropout;
+    return result;
+}
+
+void AnomalyDetector::classify(SensorDataset &dataset) {
+    for (Sensor &s : dataset.sensors)
+        s.anomalies = s.monitorA.flags(dataset.anomaly) | s.monitorB.flags(dataset.anomaly);
+}
+
+QStringList AnomalyDetector::describe(quint32 flags) {
+    QStringList names;
+    if (flags & AnomalyFlat) names << "залипание";
+    if (flags & AnomalySaturated) names << "насыщение";
+    if (flags & AnomalySpikes) names << "выбросы";
+    if (flags & AnomalyDropout) names << "пропуски";
+    return names;
+}
@@ -0,0 +1,163 @@
+#ifndef ANOMALYDETECTOR_H
+#define ANOMALYDETECTOR_H
+
+#include <QStringList>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cmath>
+
+#include "rawsample.h"
+
+struct SensorDataset;
+
+// Неисправности канала (битовые флаги Sensor::anomalies)
+enum AnomalyFlag : quint32 {
+    AnomalyFlat = 1,      // залип: одно и то же ненулевое значение подряд (или весь канал)
+    AnomalySaturated = 2, // упирается в максимум шкалы
+    AnomalySpikes = 4,    // одиночные выбросы
+    AnomalyDropout = 8    // пропуски внутри ряда
+};
+
+// Пороги классификации. Сами мониторы от порогов не зависят, поэтому смена
+// порогов - O(датчиков), без прохода по отсчетам.
+struct AnomalyOptions {
+    qint64 flatRun = 600;          // отсчетов подряд с одним значением
+    double saturationShare = 0.01; // доля отсчетов ровно на максимуме канала
+    double spikeShare = 0.001;     // доля выбросов среди проверенных отсчетов
+    double dropoutShare = 0.05;    // доля пропусков между первым и последним отсчетом
+    qint64 dropoutRun = 300;       // или столько пропусков подряд
+    bool excludeFromReference = false; // датчики с флагами не входят в эталон калибровки
+};
+
+// Потоковый детектор канала: O(1) состояния, обновляется в цикле разбора
+// (TxtParser::parseRows) на каждой строке, второго прохода по данным нет.
+//
+// Залипание - серии одинаковых значений (пропуски серию не рвут; серии нулей
+// не считаются - это темнота, а не отказ). Насыщение - сколько отсчетов ровно
+// на максимуме. Выбросы - скользящие медиана и MAD (квантили по знаку, шаг
+// от масштаба): отсчет дальше kSpikeMad * MAD от медианы, после которого ряд
+// вернулся; два таких подряд - сдвиг уровня, оценка начинается заново.
+// Пропуски - между первым и последним отсчетом канала.
+//
+// Мониторы кусков файла, сегментов и дописанных хвостов склеиваются merge по
+// порядку строк. Серии и пропуски склеиваются точно, оценка выбросов у каждого
+// куска своя (разгон kWarmup отсчетов), так что число выбросов от числа потоков
+// зависит на единицы.
+// Только поля фиксированного размера: структура целиком пишется в DatasetCache.
+struct ChannelMonitor {
+    static constexpr qint64 kWarmup = 32;
+    static constexpr double kSpikeMad = 8.0;
+    static constexpr double kRate = 0.05;       // шаг квантилей в долях масштаба
+    static constexpr double kScaleFloor = 0.01; // масштаб не меньше 1% уровня
+
+    qint64 samples = 0;
+    // Пропуски: до первого отсчета, после последнего (пока не пришел следующий), между
+    qint64 leadingGaps = 0;
+    qint64 pendingGaps = 0;
+    qint64 gaps = 0;
+    qint64 longestGap = 0;
+    // Серии одинаковых значений: первая, последняя (для склейки) и самая длинная ненулевая
+    double headValue = 0.0;
+    double tailValue = 0.0;
+    qint64 headRun = 0;
+    qint64 tailRun = 0;
+    qint64 longestRun = 0;
+    // Насыщение
+    double max = 0.0;
+    qint64 atMax = 0;
+    // Выбросы
+    double median = 0.0;
+    double mad = 0.0;
+    qint64 warm = 0;      // отсчетов в разгоне оценки
+    qint64 candidate = 0; // 1 - прошлый отсчет был вне допуска
+    qint64 judged = 0;
+    qint64 spikes = 0;
+
+    void add(RawSample v) {
+        if (isGap(v)) {
+            ++pendingGaps;
+            return;
+        }
+        if (samples == 0) {
+            leadingGaps = pendingGaps;
+        } else {
+            gaps += pendingGaps;
+            longestGap = std::max(longestGap, pendingGaps);
+        }
+        pendingGaps = 0;
+
+        const double x = double(v);
+        if (headRun == samples && (samples == 0 || x == headValue)) {
+            headValue = x;
+            ++headRun;
+        }
+        if (samples > 0 && x == tailValue) {
+            ++tailRun;
+        } else {
+            tailValue = x;
+            tailRun = 1;
+        }
+        if (x != 0.0) longestRun = std::max(longestRun, tailRun);
+
+        if (samples == 0 || x > max) {
+            max = x;
+            atMax = 1;
+        } else if (x == max) {
+            ++atMax;
+        }
+        ++samples;
+        trackSpike(x);
+    }
+
+    // count пропусков подряд, которых монитор не видел (строки без хвоста при слежении)
+    void addGaps(qint64 count) { pendingGaps += count; }
+
+    // Склейка со следующим по строкам монитором
+    void merge(const ChannelMonitor &next);
+
+    quint32 flags(const AnomalyOptions &options) const;
+
+private:
+    void trackSpike(double x) {
+        if (warm < kWarmup) {
+            // Разгон: среднее и среднее отклонение как начальные медиана и MAD
+            ++warm;
+            median += (x - median) / double(warm);
+            mad += (std::abs(x - median) - mad) / double(warm);
+            return;
+        }
+        const double scale = std::max(mad, kScaleFloor * std::abs(median)) + 1e-12;
+        const double dev = x - median;
+        if (std::abs(dev) > kSpikeMad * scale) {
+            if (candidate) {
+                // Второй подряд - уровень сменился: оценка заново с этого отсчета
+                candidate = 0;
+                warm = 1;
+                median = x;
+                mad = 0.0;
+            } else {
+                candidate = 1;
+            }
+            return;
+        }
+        if (candidate) {
+            ++spikes;
+            candidate = 0;
+        }
+        ++judged;
+        median += kRate * scale * ((dev > 0.0) ? 1.0 : (dev < 0.0 ? -1.0 : 0.0));
+        mad = std::max(0.0, mad + kRate * scale * ((std::abs(dev) > mad) ? 1.0 : -1.0));
+    }
+};
+
+class AnomalyDetector
+{
+public:
+    // Флаги датчиков по мониторам каналов (dataset.anomaly) - O(датчиков)
+    static void classify(SensorDataset &dataset);
+    // Флаги по-русски для списка датчиков и статистики
+    static QStringList describe(quint32 flags);
+};
+
+#endif // ANOMALYDETECTOR_H
@@ -0,0 +1,297 @@
+// SolarSensorsBench - замер стадий конвейера на синтетическом results.txt.
+//
+//   SolarSensorsBench [--sensors 64] [--rows 200000] [--comma] [--noise 0.02] [--repeat 5] [--out bench.json]
+//
+// Генератор детерминированный (--seed), так что цифры разных версий сравнимы.
+// Каждая стадия замеряется отдельно --repeat раз; результат - JSON в stdout
+// (или в --out): min/median/mean в мс и пропускная способность по входу.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QDateTime>
+#include <QDebug>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+
+#include "txtparser.h"
+#include "csvexporter.h"
+#include "jsonexporter.h"
+#include "columnexporter.h"
+#include "correlation.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+struct GeneratorConfig {
+    int sensors = 64;
+    qint64 rows = 200000;
+    bool commaDecimals = false;
+    double noise = 0.02;   // СКО шума относительно сигнала
+    double step = 0.1;     // шаг времени, с
+    quint64 seed = 42;
+};
+
+void appendNumber(QByteArray &out, double v, int precision, bool comma) {
+    char buf[64];
+    const std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::fixed, precision);
+    if (comma) std::replace(buf, r.ptr, '.', ',');
+    out.append(buf, r.ptr - buf);
+}
+
+// Time S1_A S1_B ... : дневная синусоида освещенности, у каждого канала свой
+// коэффициент усиления (его и должна найти калибровка) плюс гауссов шум
+bool generate(const QString &path, const GeneratorConfig &cfg) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    std::mt19937_64 rng(cfg.seed);
+    std::uniform_real_distribution<double> gainDist(0.8, 1.2);
+    std::normal_distribution<double> noiseDist(0.0, cfg.noise);
+
+    QVector<double> gains(cfg.sensors * 2);
+    for (double &g : gains) g = gainDist(rng);
+
+    QByteArray out("Time");
+    for (int s = 1; s <= cfg.sensors; ++s) {
+        const QByteArray id = QByteArray::number(s);
+        out += " S" + id + "_A S" + id + "_B";
+    }
+    out += '\n';
+
+    for (qint64 r = 0; r < cfg.rows; ++r) {
+        const double t = r * cfg.step;
+        const double light = 2000.0 + 1500.0 * std::sin(t * 2.0 * kPi / 3600.0);
+        appendNumber(out, t, 3, cfg.commaDecimals);
+        for (int c = 0; c < gains.size(); ++c) {
+            out += ' ';
+            appendNumber(out, std::max(0.0, light * gains[c] * (1.0 + noiseDist(rng))), 1, cfg.commaDecimals);
+        }
+        out += '\n';
+        if (out.size() > (1 << 22)) {
+            if (file.write(out) != out.size()) return false;
+            out.clear();
+        }
+    }
+    return file.write(out) == out.size();
+}
+
+struct Stage {
+    QString name;
+    QVector<double> ms;
+};
+
+// Прогон fn repeat раз; prepare (вне замера) готовит состояние для каждого прогона
+void measure(QVector<Stage> &stages, const QString &name, int repeat, const std::function<void()> &fn,
+             const std::function<void()> &prepare = {}) {
+    Stage stage{name, {}};
+    for (int i = 0; i < repeat; ++i) {
+        if (prepare) prepare();
+        QElapsedTimer timer;
+        timer.start();
+        fn();
+        stage.ms.append(timer.nsecsElapsed() / 1e6);
+    }
+    stages.append(stage);
+}
+
+// Копия набора с колонками, сжатыми в памяти (как при загрузке со сжатием)
+SensorDataset compressedCopy(const SensorDataset &dataset) {
+    SensorDataset packed = dataset;
+    packed.store = ChunkStore::createCompressed();
+    for (Sensor &s : packed.sensors) {
+        SampleColumn a(packed.store), b(packed.store);
+        a.append(s.rawA);
+        b.append(s.rawB);
+        s.rawA = std::move(a);
+        s.rawB = std::move(b);
+    }
+    return packed;
+}
+
+QJsonObject stageJson(const Stage &stage, qint64 inputBytes) {
+    QVector<double> sorted = stage.ms;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double v : sorted) sum += v;
+    const double median = sorted.size() % 2 ? sorted[sorted.size() / 2]
+                                            : (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) / 2.0;
+    QJsonArray runs;
+    for (double v : stage.ms) runs.append(v);
+
+    QJsonObject o;
+    o["min_ms"] = sorted.first();
+    o["median_ms"] = median;
+    o["mean_ms"] = sum / sorted.size();
+    o["runs_ms"] = runs;
+    if (inputBytes > 0 && sorted.first() > 0) o["input_mb_per_s"] = (inputBytes / 1048576.0) / (sorted.first() / 1000.0);
+    return o;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("SolarSensorsBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Per-stage benchmark of the SolarSensors pipeline on a synthetic results file.");
+    parser.addHelpOption();
+    const QCommandLineOption sensorsOpt("sensors", "Sensor count.", "n", "64");
+    const QCommandLineOption rowsOpt("rows", "Row count.", "n", "200000");
+    const QCommandLineOption commaOpt("comma", "Use comma as the decimal separator.");
+    const QCommandLineOption noiseOpt("noise", "Relative noise stddev.", "x", "0.02");
+    const QCommandLineOption seedOpt("seed", "Generator seed.", "n", "42");
+    const QCommandLineOption repeatOpt("repeat", "Runs per stage.", "n", "5");
+    const QCommandLineOption threadsOpt("threads", "Parser threads (0 = all cores).", "n", "0");
+    const QCommandLineOption keepOpt("keep", "Write the generated file here and keep it.", "file");
+    const QCommandLineOption outOpt("out", "Write the JSON report to a file instead of stdout.", "file");
+    parser.addOptions({sensorsOpt, rowsOpt, commaOpt, noiseOpt, seedOpt, repeatOpt, threadsOpt, keepOpt, outOpt});
+    parser.process(app);
+
+    GeneratorConfig cfg;
+    cfg.sensors = qMax(1, parser.value(sensorsOpt).toInt());
+    cfg.rows = qMax<qint64>(1, parser.value(rowsOpt).toLongLong());
+    cfg.commaDecimals = parser.isSet(commaOpt);
+    cfg.noise = parser.value(noiseOpt).toDouble();
+    cfg.seed = parser.value(seedOpt).toULongLong();
+    const int repeat = qMax(1, parser.value(repeatOpt).toInt());
+    const int threads = parser.value(threadsOpt).toInt();
+
+    QTemporaryDir tmp;
+    if (!tmp.isValid()) {
+        std::fprintf(stderr, "Cannot create a temporary directory\n");
+        return 1;
+    }
+    const QString txtPath = parser.isSet(keepOpt) ? parser.value(keepOpt) : tmp.filePath("bench.txt");
+
+    QElapsedTimer genTimer;
+    genTimer.start();
+    if (!generate(txtPath, cfg)) {
+        std::fprintf(stderr, "Cannot write %s\n", qPrintable(txtPath));
+        return 1;
+    }
+    const qint64 genMs = genTimer.elapsed();
+
+    QFile file(txtPath);
+    if (!file.open(QIODevice::ReadOnly)) return 1;
+    const QByteArray content = file.readAll();
+    const char *begin = content.constData();
+    const char *end = begin + content.size();
+    const qint64 inputBytes = content.size();
+
+    QVector<Stage> stages;
+
+    TxtParser::Layout layout;
+    qsizetype bodyOffset = 0;
+    measure(stages, "header", repeat, [&] { TxtParser::parseHeader(begin, end, layout, bodyOffset); });
+
+    SensorDataset dataset;
+    measure(stages, "parse", repeat, [&] { TxtParser::parseBuffer(begin, end, dataset, threads); },
+            [&] { dataset = SensorDataset(); });
+
+    const qint64 parsedRows = dataset.time.size();
+    const int parsedSensors = dataset.sensors.size();
+    measure(stages, "computeStats", repeat, [&] { dataset.computeStats(); });
+    measure(stages, "buildLod", repeat, [&] { dataset.buildLod(); });
+    measure(stages, "buildAggregates", repeat, [&] { dataset.buildAggregates(); });
+    measure(stages, "preCalculateCalibration", repeat, [&] { dataset.preCalculateCalibration(); });
+    measure(stages, "calculateRanges", repeat, [&] { dataset.calculateRanges(); });
+
+    // fillSeries без QtCharts: те же точки, что уходят в QXYSeries::replace, для всех датчиков
+    const int pixelWidth = 2000;
+    QList<QPointF> points;
+    measure(stages, "fillSeries", repeat, [&] {
+        for (const Sensor &s : std::as_const(dataset.sensors)) {
+            dataset.chartPoints(s, 0, true, 0, s.size(), pixelWidth, points);
+            dataset.chartPoints(s, 1, true, 0, s.size(), pixelWidth, points);
+        }
+    });
+    measure(stages, "fillSeriesZoom", repeat, [&] {
+        // Окно в 1% данных посередине - типичный кадр зума
+        const double span = (dataset.maxTime - dataset.minTime) / 100.0;
+        const double from = (dataset.minTime + dataset.maxTime - span) / 2.0;
+        for (const Sensor &s : std::as_const(dataset.sensors)) {
+            qsizetype a = 0, b = 0;
+            dataset.sampleRange(s, from, from + span, a, b);
+            dataset.chartPoints(s, 0, true, a, b, pixelWidth, points);
+        }
+    });
+
+    const QString csvPath = tmp.filePath("bench.csv");
+    const QString jsonPath = tmp.filePath("bench.json");
+    const QString columnsPath = tmp.filePath("bench.scol");
+    measure(stages, "exportCsv", repeat, [&] { CsvExporter::write(dataset, csvPath); });
+    measure(stages, "exportJson", repeat, [&] { JsonExporter::write(dataset, jsonPath); });
+    measure(stages, "exportJsonCompact", repeat,
+            [&] { JsonExporter::write(dataset, jsonPath, nullptr, JsonExporter::Format::Compact); });
+    measure(stages, "exportColumns", repeat, [&] { ColumnExporter::write(dataset, columnsPath); });
+    CorrelationMatrix correlation;
+    measure(stages, "correlation", repeat, [&] { CorrelationEngine::compute(dataset, correlation); });
+
+    // Те же стадии поверх сжатых колонок: чтение идет через распаковку кусков
+    SensorDataset packed;
+    measure(stages, "compressColumns", repeat, [&] { packed = compressedCopy(dataset); },
+            [&] { packed = SensorDataset(); });
+    measure(stages, "computeStatsCompressed", repeat, [&] { packed.computeStats(); });
+    measure(stages, "buildLodCompressed", repeat, [&] { packed.buildLod(); });
+    measure(stages, "exportCsvCompressed", repeat, [&] { CsvExporter::write(packed, csvPath); });
+
+    QJsonObject compression;
+    compression["ratio"] = packed.store->compressionRatio();
+    compression["packed_bytes"] = packed.store->packedBytes();
+    compression["decode_mb_per_s"] = packed.store->decodeMBps();
+
+    QJsonObject config;
+    config["sensors"] = cfg.sensors;
+    config["rows"] = cfg.rows;
+    config["comma_decimals"] = cfg.commaDecimals;
+    config["noise"] = cfg.noise;
+    config["seed"] = QString::number(cfg.seed);
+    config["repeat"] = repeat;
+    config["parser_threads"] = threads;
+    config["ideal_thread_count"] = QThread::idealThreadCount();
+    config["raw_sample_bytes"] = int(sizeof(RawSample));
+
+    QJsonObject stageObj;
+    for (const Stage &stage : std::as_const(stages)) {
+        const bool readsInput = (stage.name == "header" || stage.name == "parse");
+        stageObj[stage.name] = stageJson(stage, readsInput ? inputBytes : 0);
+    }
+
+    QJsonObject report;
+    report["benchmark"] = "SolarSensorsBench";
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["qt_version"] = QString::fromLatin1(qVersion());
+    report["config"] = config;
+    report["input_bytes"] = inputBytes;
+    report["generate_ms"] = genMs;
+    report["parsed_rows"] = parsedRows;
+    report["parsed_sensors"] = parsedSensors;
+    report["stages"] = stageObj;
+    report["compression"] = compression;
+
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outOpt)) {
+        QFile out(parser.value(outOpt));
+        if (!out.open(QIODevice::WriteOnly) || out.write(json) != json.size()) {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(parser.value(outOpt)));
+            return 1;
+        }
+    } else {
+        std::fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,290 @@
+#include "calibration.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr int kLanes = 8;
+
+// Сумма с компенсацией ошибки округления (Neumaier)
+struct CompensatedSum {
+    double sum = 0.0;
+    double compensation = 0.0;
+
+    void add(double v) {
+        const double t = sum + v;
+        if (qAbs(sum) >= qAbs(v)) compensation += (sum - t) + v;
+        else compensation += (v - t) + sum;
+        sum = t;
+    }
+    double value() const { return sum + compensation; }
+};
+
+// Один блок: полосы независимы, поэтому цикл векторизуется без -ffast-math.
+// Пропуск (NaN) дает 0 в сумму и не проходит сравнения min/max.
+template <typename T>
+void accumulateBlock(const T *x, qsizetype n, CompensatedSum &total, ChannelStats &stats) {
+    double acc[kLanes] = {};
+    double lo[kLanes];
+    double hi[kLanes];
+    qsizetype cnt[kLanes] = {};
+    for (int l = 0; l < kLanes; ++l) {
+        lo[l] = std::numeric_limits<double>::max();
+        hi[l] = std::numeric_limits<double>::lowest();
+    }
+
+    qsizetype i = 0;
+    for (; i + kLanes <= n; i += kLanes) {
+        for (int l = 0; l < kLanes; ++l) {
+            const double v = x[i + l];
+            const bool valid = (v == v);
+            acc[l] += valid ? v : 0.0;
+            cnt[l] += valid ? 1 : 0;
+            lo[l] = (v < lo[l]) ? v : lo[l];
+            hi[l] = (v > hi[l]) ? v : hi[l];
+        }
+    }
+    for (int l = 0; i < n; ++i, ++l) {
+        const double v = x[i];
+        if (v != v) continue;
+        acc[l] += v;
+        ++cnt[l];
+        lo[l] = std::min(lo[l], v);
+        hi[l] = std::max(hi[l], v);
+    }
+
+    // Попарное сведение полос: 8 -> 4 -> 2 -> 1
+    for (int width = kLanes / 2; width > 0; width /= 2) {
+        for (int l = 0; l < width; ++l) {
+            acc[l] += acc[l + width];
+            cnt[l] += cnt[l + width];
+            lo[l] = std::min(lo[l], lo[l + width]);
+            hi[l] = std::max(hi[l], hi[l + width]);
+        }
+    }
+
+    total.add(acc[0]);
+    stats.count += cnt[0];
+    stats.min = std::min(stats.min, lo[0]);
+    stats.max = std::max(stats.max, hi[0]);
+}
+
+template <typename T>
+ChannelStats columnStatsImpl(const T *data, qsizetype count) {
+    ChannelStats stats;
+    CompensatedSum total;
+    for (qsizetype from = 0; from < count; from += CalibrationEngine::kBlockSize) {
+        const qsizetype n = std::min(CalibrationEngine::kBlockSize, count - from);
+        accumulateBlock(data + from, n, total, stats);
+    }
+    stats.sum = total.value();
+    return stats;
+}
+
+void clearDrift(SensorDataset &dataset) {
+    dataset.rolling.reference.clear();
+    for (Sensor &s : dataset.sensors) {
+        s.driftA = ChannelDrift();
+        s.driftB = ChannelDrift();
+    }
+}
+
+// Скользящее среднее по окну [j - half, j + half] корзин; NaN - в окне нет отсчетов
+void slidingMeans(const QVector<ChannelStats> &bins, qsizetype binCount, QVector<double> &means) {
+    const qsizetype half = RollingCalibration::kSpan / 2;
+    const qsizetype n = std::min(bins.size(), binCount);
+    means.fill(std::numeric_limits<double>::quiet_NaN(), binCount);
+
+    double sum = 0.0;
+    qsizetype count = 0;
+    for (qsizetype j = 0; j < std::min(half, n); ++j) {
+        sum += bins[j].sum;
+        count += bins[j].count;
+    }
+    for (qsizetype j = 0; j < binCount; ++j) {
+        if (j + half < n) {
+            sum += bins[j + half].sum;
+            count += bins[j + half].count;
+        }
+        if (j - half - 1 >= 0 && j - half - 1 < n) {
+            sum -= bins[j - half - 1].sum;
+            count -= bins[j - half - 1].count;
+        }
+        if (count > 0) means[j] = sum / count;
+    }
+}
+
+// Корзины без коэффициента (NaN) получают ближайший слева, в начале - первый найденный
+void fillGaps(QVector<double> &k) {
+    const auto firstValid = std::find_if(k.begin(), k.end(), [](double v) { return !std::isnan(v); });
+    if (firstValid == k.end()) {
+        k.clear();
+        return;
+    }
+    double last = *firstValid;
+    for (double &v : k) {
+        if (std::isnan(v)) v = last;
+        else last = v;
+    }
+}
+
+// Исключать из эталона нечего, если под подозрением все датчики
+bool allFlagged(const QVector<Sensor> &sensors) {
+    return std::all_of(sensors.cbegin(), sensors.cend(), [](const Sensor &s) { return s.anomalies != 0; });
+}
+
+} // namespace
+
+ChannelStats CalibrationEngine::columnStats(const float *data, qsizetype count) {
+    return columnStatsImpl(data, count);
+}
+
+ChannelStats CalibrationEngine::columnStats(const double *data, qsizetype count) {
+    return columnStatsImpl(data, count);
+}
+
+ChannelStats CalibrationEngine::columnStats(const SampleColumn &column, qsizetype from, qsizetype to) {
+    ChannelStats stats;
+    CompensatedSum total;
+    column.forEachSpan(from, to, [&](const RawSample *data, qsizetype, qsizetype count) {
+        for (qsizetype i = 0; i < count; i += kBlockSize)
+            accumulateBlock(data + i, std::min(kBlockSize, count - i), total, stats);
+    });
+    stats.sum = total.value();
+    return stats;
+}
+
+void CalibrationEngine::computeStats(SensorDataset &dataset) {
+    const double *time = dataset.time.constData();
+
+    QtConcurrent::blockingMap(dataset.sensors, [time](Sensor &s) {
+        s.statsA = columnStats(s.rawA, 0, s.size());
+        s.statsB = columnStats(s.rawB, 0, s.size());
+        s.statsTime = columnStats(time + s.offset, s.size());
+    });
+}
+
+void CalibrationEngine::computeDrift(SensorDataset &dataset, qsizetype fromRow) {
+    RollingCalibration &rolling = dataset.rolling;
+    const QVector<double> &time = dataset.time;
+    if (rolling.window <= 0.0 || time.isEmpty()) {
+        clearDrift(dataset);
+        return;
+    }
+
+    if (fromRow <= 0) {
+        fromRow = 0;
+        rolling.start = time.first();
+    }
+    const double step = rolling.step();
+    const double binsNeeded = std::floor((time.last() - rolling.start) / step) + 1.0;
+    if (!(binsNeeded <= double(RollingCalibration::kMaxBins))) {
+        qWarning() << "Rolling calibration window" << rolling.window << "s is too short for this dataset";
+        clearDrift(dataset);
+        return;
+    }
+    const qsizetype binCount = qsizetype(binsNeeded);
+    const qsizetype firstBin = (fromRow < time.size())
+                                   ? std::clamp(qsizetype((time[fromRow] - rolling.start) / step), qsizetype(0), binCount - 1)
+                                   : binCount - 1;
+
+    // Границы корзин в строках: время в файле идет по возрастанию
+    QVector<qsizetype> bounds(binCount - firstBin + 1);
+    for (qsizetype j = firstBin; j <= binCount; ++j) {
+        const double t = rolling.start + j * step;
+        bounds[j - firstBin] = (j == binCount) ? time.size()
+                                               : std::lower_bound(time.cbegin(), time.cend(), t) - time.cbegin();
+    }
+
+    QtConcurrent::blockingMap(dataset.sensors, [&bounds, firstBin, binCount](Sensor &s) {
+        s.driftA.bins.resize(binCount);
+        s.driftB.bins.resize(binCount);
+        for (qsizetype j = firstBin; j < binCount; ++j) {
+            const qsizetype from = std::clamp(bounds[j - firstBin] - s.offset, qsizetype(0), s.size());
+            const qsizetype to = std::clamp(bounds[j - firstBin + 1] - s.offset, qsizetype(0), s.size());
+            s.driftA.bins[j] = columnStats(s.rawA, from, to);
+            s.driftB.bins[j] = columnStats(s.rawB, from, to);
+        }
+    });
+}
+
+void CalibrationEngine::calibrateRolling(SensorDataset &dataset) {
+    RollingCalibration &rolling = dataset.rolling;
+    QVector<Sensor> &sensors = dataset.sensors;
+    qsizetype binCount = 0;
+    for (const Sensor &s : std::as_const(sensors)) binCount = std::max(binCount, s.driftA.bins.size());
+    if (rolling.window <= 0.0 || binCount == 0) {
+        clearDrift(dataset);
+        return;
+    }
+
+    // Сначала в k - скользящие средние каналов, опорное значение окна - по ним
+    QtConcurrent::blockingMap(sensors, [binCount](Sensor &s) {
+        slidingMeans(s.driftA.bins, binCount, s.driftA.k);
+        slidingMeans(s.driftB.bins, binCount, s.driftB.k);
+    });
+
+    const bool exclude = dataset.anomaly.excludeFromReference && !allFlagged(sensors);
+
+    // Как globalReference, но делится на число датчиков с данными в окне:
+    // датчик, который еще не включился, не должен занижать эталон
+    rolling.reference.fill(std::numeric_limits<double>::quiet_NaN(), binCount);
+    for (qsizetype j = 0; j < binCount; ++j) {
+        double sum = 0.0;
+        int count = 0;
+        for (const Sensor &s : std::as_const(sensors)) {
+            if (exclude && s.anomalies) continue;
+            const double a = s.driftA.k[j];
+            const double b = s.driftB.k[j];
+            if (std::isnan(a) || std::isnan(b)) continue;
+            sum += a + b;
+            ++count;
+        }
+        if (count > 0) rolling.reference[j] = sum / count;
+    }
+
+    QtConcurrent::blockingMap(sensors, [&rolling, binCount](Sensor &s) {
+        for (ChannelDrift *drift : {&s.driftA, &s.driftB}) {
+            for (qsizetype j = 0; j < binCount; ++j) {
+                const double mean = drift->k[j];
+                const double ref = rolling.reference[j];
+                if (!std::isnan(mean) && !std::isnan(ref)) drift->k[j] = SensorDataset::safeDivide(ref / 2.0, mean);
+                else drift->k[j] = std::numeric_limits<double>::quiet_NaN();
+            }
+            fillGaps(drift->k);
+        }
+    });
+    fillGaps(rolling.reference);
+}
+
+void CalibrationEngine::calibrate(SensorDataset &dataset) {
+    QVector<Sensor> &sensors = dataset.sensors;
+    if (sensors.isEmpty()) return;
+
+    const int sensorCount = sensors.size();
+    const bool exclude = dataset.anomaly.excludeFromReference && !allFlagged(sensors);
+    double totalIntensitySum = 0.0;
+    int referenceCount = 0;
+    for (const Sensor &s : std::as_const(sensors)) {
+        if (exclude && s.anomalies) continue;
+        ++referenceCount;
+        if (s.statsA.count == 0) continue;
+        totalIntensitySum += s.statsA.mean() + s.statsB.mean();
+    }
+
+    dataset.globalReference = totalIntensitySum / referenceCount;
+    const double halfRef = dataset.globalReference / 2.0;
+
+    double totalDev = 0.0;
+    for (Sensor &s : sensors) {
+        s.kA = SensorDataset::safeDivide(halfRef, s.statsA.mean());
+        s.kB = SensorDataset::safeDivide(halfRef, s.statsB.mean());
+        totalDev += qAbs(1.0 - s.kA) + qAbs(1.0 - s.kB);
+    }
+    dataset.avgDeviation = totalDev / (2 * sensorCount);
+}
@@ -0,0 +1,42 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include "sensordata.h"
+
+// Калибровка датчиков по средним значениям каналов.
+//
+// computeStats проходит по каждому датчику один раз: сумма, min/max и число
+// отсчетов считаются в 8 независимых полосах (компилятор разворачивает их в SIMD),
+// блоки по kBlockSize складываются с компенсацией (Neumaier), порядок сложения
+// фиксирован - результат не зависит от числа потоков. Датчики считаются параллельно.
+//
+// calibrate использует только агрегаты, поэтому перекалибровка стоит O(датчиков):
+// скорректированные значения - это raw * k при чтении (SensorDataset::coefficient).
+// Там же один раз считается среднее отклонение avgDeviation для статистики и экспорта.
+// С anomaly.excludeFromReference датчики с флагами неисправности (AnomalyDetector)
+// в эталон не входят, но свои коэффициенты получают.
+//
+// Скользящая калибровка (RollingCalibration) устроена так же: computeDrift - проход
+// по отсчетам в агрегаты корзин времени, calibrateRolling - только по агрегатам.
+class CalibrationEngine
+{
+public:
+    static constexpr qsizetype kBlockSize = 4096;
+
+    static void computeStats(SensorDataset &dataset);
+    static void calibrate(SensorDataset &dataset);
+
+    // Агрегаты корзин по строкам начиная с fromRow: при загрузке - все, при слежении -
+    // только корзины дописанных строк. Датчики считаются параллельно.
+    static void computeDrift(SensorDataset &dataset, qsizetype fromRow = 0);
+    // Коэффициенты корзин по скользящим суммам - O(датчиков * корзин)
+    static void calibrateRolling(SensorDataset &dataset);
+
+    // Агрегаты одного столбца; пропуски (NaN) не учитываются
+    static ChannelStats columnStats(const float *data, qsizetype count);
+    static ChannelStats columnStats(const double *data, qsizetype count);
+    // Отсчеты [from, to) колонки, в том числе лежащей на диске (по кускам)
+    static ChannelStats columnStats(const SampleColumn &column, qsizetype from, qsizetype to);
+};
+
+#endif // CALIBRATION_H
@@ -0,0 +1,171 @@
+#include "chunkstore.h"
+#include "columncodec.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace {
+
+// Кэш меньше пары десятков кусков не переживет даже параллельный проход по датчикам
+constexpr qint64 kMinCachedChunks = 16;
+
+} // namespace
+
+ChunkStore::ChunkStore(qint64 memoryLimit, bool compressed)
+    : m_memoryLimit(std::max(memoryLimit, kMinCachedChunks * kChunkBytes)), m_compressed(compressed) {
+    m_cache.setMaxCost(qsizetype(m_memoryLimit));
+}
+
+QSharedPointer<ChunkStore> ChunkStore::create(qint64 memoryLimit) {
+    QSharedPointer<ChunkStore> store(new ChunkStore(memoryLimit, false));
+
+    // Рядом с кэшем наборов; файл удаляется вместе с последней колонкой набора
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/chunks";
+    QDir().mkpath(dir);
+    store->m_file.setFileTemplate(QDir(dir).filePath("XXXXXX.chunks"));
+    if (!store->m_file.open()) {
+        qWarning() << "Failed to create chunk file in" << dir;
+        return {};
+    }
+    return store;
+}
+
+QSharedPointer<ChunkStore> ChunkStore::createCompressed(qint64 memoryLimit) {
+    return QSharedPointer<ChunkStore>(new ChunkStore(memoryLimit, true));
+}
+
+bool ChunkStore::forColumns(qint64 columnBytes, const ColumnStorageOptions &options,
+                            QSharedPointer<ChunkStore> &store) {
+    store.reset();
+    // Не помещается в половину лимита даже целиком - на диск, сжатие тут не спасет
+    if (options.memoryLimit > 0 && columnBytes > options.memoryLimit / 2) {
+        store = create(options.memoryLimit / 4);
+        return !store.isNull();
+    }
+    if (options.compress) store = createCompressed();
+    return true;
+}
+
+qint64 ChunkStore::write(const RawSample *data) {
+    if (m_compressed) {
+        // Сжатие - без блокировки: колонки датчиков дописываются параллельно
+        QByteArray packed = ColumnCodec::encode(data, kChunkSamples);
+        QMutexLocker lock(&m_mutex);
+        const qint64 id = m_packed.size();
+        m_packedBytes += packed.size();
+        m_packed.append(std::move(packed));
+        m_cache.insert(id, new Chunk(new QVector<RawSample>(data, data + kChunkSamples)), qsizetype(kChunkBytes));
+        return id;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    const qint64 id = m_chunkCount++;
+    if (!m_file.seek(id * kChunkBytes)
+        || m_file.write(reinterpret_cast<const char *>(data), kChunkBytes) != kChunkBytes) {
+        if (!m_error) qWarning() << "Failed to write chunk file:" << m_file.fileName();
+        m_error = true;
+        return id;
+    }
+
+    // Только что записанный кусок почти наверняка сейчас же прочитают (статистика, пирамиды)
+    m_cache.insert(id, new Chunk(new QVector<RawSample>(data, data + kChunkSamples)), qsizetype(kChunkBytes));
+    return id;
+}
+
+ChunkStore::Chunk ChunkStore::read(qint64 id) {
+    QByteArray packed;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (const Chunk *cached = m_cache.object(id)) {
+            ++m_hits;
+            return *cached;
+        }
+        ++m_misses;
+        if (!m_compressed) return readFile(id);
+        if (id >= 0 && id < m_packed.size()) packed = m_packed.at(id);
+    }
+
+    // Распаковка тоже без блокировки; один кусок изредка распакуют два потока - не страшно
+    QElapsedTimer timer;
+    timer.start();
+    QVector<RawSample> *samples = new QVector<RawSample>(kChunkSamples);
+    const Chunk chunk(samples);
+    const bool ok = !packed.isEmpty() && ColumnCodec::decode(packed, samples->data(), kChunkSamples);
+    const qint64 ns = timer.nsecsElapsed();
+
+    QMutexLocker lock(&m_mutex);
+    if (!ok) {
+        if (!m_error) qWarning() << "Failed to decode compressed chunk" << id;
+        m_error = true;
+        return {};
+    }
+    m_decodeNs += ns;
+    ++m_decodedChunks;
+    m_cache.insert(id, new Chunk(chunk), qsizetype(kChunkBytes));
+    return chunk;
+}
+
+ChunkStore::Chunk ChunkStore::readFile(qint64 id) {
+    QVector<RawSample> *samples = new QVector<RawSample>(kChunkSamples);
+    const Chunk chunk(samples);
+    if (id < 0 || id >= m_chunkCount || !m_file.seek(id * kChunkBytes)
+        || m_file.read(reinterpret_cast<char *>(samples->data()), kChunkBytes) != kChunkBytes) {
+        if (!m_error) qWarning() << "Failed to read chunk file:" << m_file.fileName();
+        m_error = true;
+        return {};
+    }
+    m_cache.insert(id, new Chunk(chunk), qsizetype(kChunkBytes));
+    return chunk;
+}
+
+bool ChunkStore::hasError() const {
+    QMutexLocker lock(&m_mutex);
+    return m_error;
+}
+
+qint64 ChunkStore::diskBytes() const {
+    QMutexLocker lock(&m_mutex);
+    return m_chunkCount * kChunkBytes;
+}
+
+qint64 ChunkStore::hits() const {
+    QMutexLocker lock(&m_mutex);
+    return m_hits;
+}
+
+qint64 ChunkStore::misses() const {
+    QMutexLocker lock(&m_mutex);
+    return m_misses;
+}
+
+qint64 ChunkStore::packedBytes() const {
+    QMutexLocker lock(&m_mutex);
+    return m_packedBytes;
+}
+
+double ChunkStore::compressionRatio() const {
+    QMutexLocker lock(&m_mutex);
+    if (m_packedBytes == 0) return 0.0;
+    return double(m_packed.size() * kChunkBytes) / double(m_packedBytes);
+}
+
+double ChunkStore::decodeMBps() const {
+    QMutexLocker lock(&m_mutex);
+    if (m_decodeNs == 0) return 0.0;
+    return (m_decodedChunks * kChunkBytes / 1048576.0) / (m_decodeNs / 1e9);
+}
+
+QString ChunkStore::describe() const {
+    if (!m_compressed) return QString("%1 MB on disk").arg(diskBytes() / 1048576.0, 0, 'f', 1);
+
+    QString text = QString("compressed x%1, %2 MB in memory")
+                       .arg(compressionRatio(), 0, 'f', 2)
+                       .arg(packedBytes() / 1048576.0, 0, 'f', 1);
+    const double decode = decodeMBps();
+    if (decode > 0) text += QString(", decode %1 MB/s").arg(decode, 0, 'f', 0);
+    return text;
+}
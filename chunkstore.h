@@ -0,0 +1,87 @@
+#ifndef CHUNKSTORE_H
+#define CHUNKSTORE_H
+
+#include <QCache>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QTemporaryFile>
+#include <QVector>
+
+#include "rawsample.h"
+
+// Где держать сырые колонки набора (вне класса - см. CsvExportOptions)
+struct ColumnStorageOptions {
+    qint64 memoryLimit = 0; // байт, 0 - без лимита; колонки больше половины лимита - на диск
+    bool compress = false;  // иначе - сжатые куски в памяти (ColumnCodec)
+};
+
+// Хранилище колонок кусками по kChunkSamples отсчетов плюс LRU-кэш распакованных
+// кусков (QCache), который занимает не больше memoryLimit байт:
+// - на диске (create) - для наборов больше ОЗУ, куски во временном файле;
+// - сжатое (createCompressed) - куски в памяти, сжатые ColumnCodec.
+// Кусок пишется один раз и дальше только читается. Потокобезопасно.
+// Прочитанный кусок живет, пока на него есть ссылка, даже если кэш его уже вытеснил.
+class ChunkStore
+{
+public:
+    static constexpr qsizetype kChunkSamples = 65536;
+    static constexpr qint64 kChunkBytes = kChunkSamples * qint64(sizeof(RawSample));
+
+    using Chunk = QSharedPointer<const QVector<RawSample>>;
+
+    // nullptr, если не удалось создать временный файл
+    static QSharedPointer<ChunkStore> create(qint64 memoryLimit);
+    static QSharedPointer<ChunkStore> createCompressed(qint64 memoryLimit = kCompressedCacheBytes);
+    // Хранилище для колонок общим размером columnBytes по настройкам; store = nullptr -
+    // колонки остаются обычными векторами в памяти. false - не удалось создать файл
+    static bool forColumns(qint64 columnBytes, const ColumnStorageOptions &options,
+                           QSharedPointer<ChunkStore> &store);
+
+    // Полный кусок (kChunkSamples отсчетов) -> номер куска
+    qint64 write(const RawSample *data);
+    // nullptr при ошибке чтения
+    Chunk read(qint64 id);
+
+    // Была ошибка записи или чтения: данные набора неполные
+    bool hasError() const;
+
+    bool isCompressed() const { return m_compressed; }
+    qint64 memoryLimit() const { return m_memoryLimit; }
+    qint64 diskBytes() const;
+    qint64 hits() const;
+    qint64 misses() const;
+
+    // Сжатые куски в памяти, байт
+    qint64 packedBytes() const;
+    // Сжатие: байт отсчетов / байт в сжатом виде, 0 - ничего не записано
+    double compressionRatio() const;
+    // Распаковка: МБ отсчетов в секунду по всем промахам кэша, 0 - еще не было
+    double decodeMBps() const;
+    // Для журнала: сжатие и скорость распаковки или объем на диске
+    QString describe() const;
+
+private:
+    static constexpr qint64 kCompressedCacheBytes = 64 * 1024 * 1024;
+
+    ChunkStore(qint64 memoryLimit, bool compressed);
+    // Под m_mutex
+    Chunk readFile(qint64 id);
+
+    mutable QMutex m_mutex;
+    QTemporaryFile m_file;
+    QCache<qint64, Chunk> m_cache;
+    qint64 m_memoryLimit = 0;
+    qint64 m_chunkCount = 0;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+    bool m_error = false;
+
+    bool m_compressed = false;
+    QVector<QByteArray> m_packed; // сжатые куски по номерам
+    qint64 m_packedBytes = 0;
+    qint64 m_decodeNs = 0;
+    qint64 m_decodedChunks = 0;
+};
+
+#endif // CHUNKSTORE_H
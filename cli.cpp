@@ -0,0 +1,293 @@
+// SolarSensorsCli - пакетная обработка results.txt без GUI (QCoreApplication).
+//
+//   SolarSensorsCli [-o <папка>] [-j <потоков>] [--csv] [--json] [--compact]
+//                   [--memory-limit <МБ>] [--compress] [--calibration-window <с>] [--exclude-anomalous]
+//                   [--resample <с>] [--columns] [--correlation] [--session concat|overlay] [--trace <file>] <файл|папка|маска>...
+//
+// Каждый файл: разбор -> калибровка -> CSV/JSON (и .scol с --columns) рядом (или в -o). Файлы идут
+// параллельно в пуле из -j потоков, в конце пишется summary.csv с коэффициентами
+// и флагами неисправностей датчиков.
+// С --session все файлы - одна сессия (DatasetLoader::loadSession) с калибровкой
+// по всем прогонам, результат - session.csv/json.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <cstdio>
+
+#include "datasetloader.h"
+#include "csvexporter.h"
+#include "jsonexporter.h"
+#include "columnexporter.h"
+#include "tracer.h"
+
+namespace {
+
+struct BatchOptions {
+    QString outputDir;     // пусто - рядом с исходным файлом
+    bool csv = true;
+    bool json = true;
+    bool compact = false;
+    bool columns = false;  // дополнительно бинарные колонки .scol
+    bool correlation = false; // матрица корреляций каналов в JSON
+    bool excludeAnomalous = false; // датчики с флагами неисправности не входят в эталон
+    bool useCache = false;
+    int parseThreads = 1;  // потоков на разбор одного файла
+    ColumnStorageOptions storage;
+    double calibrationWindow = 0; // секунд, 0 - один коэффициент на весь файл
+    double step = 0;              // шаг сетки выгрузки, с; 0 - строки файла как есть
+};
+
+struct SensorSummary {
+    int id;
+    QString name;
+    double kA;
+    double kB;
+    qsizetype samples;
+    quint32 anomalies;
+};
+
+struct FileResult {
+    QString path;
+    bool ok = false;
+    qint64 rows = 0;
+    qint64 ms = 0;
+    double globalReference = 0.0;
+    double avgDeviation = 0.0;
+    QVector<SensorSummary> sensors;
+};
+
+// Файлы, папки (все *.txt) и маски вида data/run_*.txt
+QStringList collectInputs(const QStringList &args) {
+    QStringList files;
+    for (const QString &arg : args) {
+        const QFileInfo fi(arg);
+        if (fi.isDir()) {
+            QDirIterator it(fi.absoluteFilePath(), {"*.txt"}, QDir::Files);
+            QStringList found;
+            while (it.hasNext()) found << it.next();
+            found.sort();
+            files << found;
+        } else if (arg.contains('*') || arg.contains('?') || arg.contains('[')) {
+            const QFileInfo pattern(arg);
+            QDir dir = pattern.dir();
+            const QStringList names = dir.entryList({pattern.fileName()}, QDir::Files, QDir::Name);
+            for (const QString &name : names) files << dir.absoluteFilePath(name);
+        } else if (fi.isFile()) {
+            files << fi.absoluteFilePath();
+        } else {
+            qWarning() << "No such file:" << arg;
+        }
+    }
+    files.removeDuplicates();
+    return files;
+}
+
+QString outputPath(const QString &txtPath, const BatchOptions &options, const QString &suffix) {
+    const QFileInfo fi(txtPath);
+    const QDir dir(options.outputDir.isEmpty() ? fi.absolutePath() : options.outputDir);
+    return dir.filePath(fi.completeBaseName() + suffix);
+}
+
+DatasetLoadOptions loadOptions(const BatchOptions &options) {
+    DatasetLoadOptions load;
+    load.useCache = options.useCache;
+    load.forDisplay = false; // графика нет - пирамиды и суммы по окнам не нужны
+    load.threadCount = options.parseThreads;
+    load.storage = options.storage;
+    load.calibrationWindow = options.calibrationWindow;
+    load.anomaly.excludeFromReference = options.excludeAnomalous;
+    return load;
+}
+
+// Экспорт загруженного набора рядом с txtPath (или в -o) и строка для summary
+void exportDataset(const SensorDataset &dataset, const QString &txtPath, const BatchOptions &options,
+                   const QElapsedTimer &timer, FileResult &result) {
+    bool ok = true;
+    if (options.csv) {
+        CsvExporter::Options csv;
+        csv.step = options.step;
+        ok = CsvExporter::write(dataset, outputPath(txtPath, options, ".csv"), nullptr, csv) && ok;
+    }
+    if (options.json) {
+        const JsonExporter::Format format = options.compact ? JsonExporter::Format::Compact
+                                                            : JsonExporter::Format::Indented;
+        CorrelationMatrix correlation;
+        if (options.correlation) CorrelationEngine::compute(dataset, correlation);
+        ok = JsonExporter::write(dataset, outputPath(txtPath, options, ".json"), nullptr, format, options.step,
+                                 options.correlation ? &correlation : nullptr) && ok;
+    }
+    if (options.columns) ok = ColumnExporter::write(dataset, outputPath(txtPath, options, ".scol")) && ok;
+
+    result.ok = ok;
+    result.rows = dataset.time.size();
+    result.globalReference = dataset.globalReference;
+    result.avgDeviation = dataset.avgDeviation;
+    for (const Sensor &s : std::as_const(dataset.sensors))
+        result.sensors.append({s.id, s.name, s.kA, s.kB, s.statsA.count, s.anomalies});
+    result.ms = timer.elapsed();
+    qInfo().noquote() << (ok ? "OK  " : "FAIL") << txtPath << result.rows << "rows," << result.ms << "ms";
+    // После экспорта: все куски прочитаны, скорость распаковки - по всему набору
+    if (dataset.store) qInfo().noquote() << "    columns:" << dataset.store->describe();
+}
+
+FileResult processFile(const QString &txtPath, const BatchOptions &options) {
+    FileResult result;
+    result.path = txtPath;
+    QElapsedTimer timer;
+    timer.start();
+
+    SensorDataset dataset;
+    if (DatasetLoader::load(txtPath, dataset, nullptr, loadOptions(options)))
+        exportDataset(dataset, txtPath, options, timer, result);
+    return result;
+}
+
+// Все файлы одной сессией; выгрузка - session.* в -o или в папке первого файла
+FileResult processSession(const QStringList &files, SessionMode mode, const BatchOptions &options) {
+    FileResult result;
+    result.path = QDir(QFileInfo(files.first()).absolutePath()).filePath("session.txt");
+    QElapsedTimer timer;
+    timer.start();
+
+    SensorDataset dataset;
+    if (DatasetLoader::loadSession(files, mode, dataset, nullptr, loadOptions(options)))
+        exportDataset(dataset, result.path, options, timer, result);
+    return result;
+}
+
+// Одна строка на датчик каждого файла, разделитель ';' как в CSV-экспорте
+bool writeSummary(const QString &path, const QList<FileResult> &results) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Failed to write summary:" << path;
+        return false;
+    }
+    QByteArray out("\xEF\xBB\xBF"
+                   "File;Status;Global reference;Sensor;Name;Coeff A;Coeff B;Error A (%);Error B (%);Samples;Anomalies\n");
+    for (const FileResult &r : results) {
+        const QByteArray head = r.path.toUtf8() + ';' + (r.ok ? "ok" : "failed") + ';'
+                                + QByteArray::number(r.globalReference, 'f', 2);
+        if (r.sensors.isEmpty()) out += head + ";;;;;;;;\n";
+        for (const SensorSummary &s : r.sensors) {
+            out += head + ';' + QByteArray::number(s.id) + ';' + s.name.toUtf8() + ';'
+                   + QByteArray::number(s.kA, 'f', 4) + ';' + QByteArray::number(s.kB, 'f', 4) + ';'
+                   + QByteArray::number((s.kA - 1.0) * 100.0, 'f', 2) + ';'
+                   + QByteArray::number((s.kB - 1.0) * 100.0, 'f', 2) + ';'
+                   + QByteArray::number(s.samples) + ';'
+                   + AnomalyDetector::describe(s.anomalies).join(", ").toUtf8() + '\n';
+        }
+    }
+    return file.write(out) == out.size();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("SolarSensors");
+    QCoreApplication::setApplicationName("SolarSensors");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Batch calibration and export of SolarSensors results files.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("inputs", "Result files, directories (*.txt) or wildcard patterns.", "<input>...");
+    const QCommandLineOption outputOpt({"o", "output"}, "Output directory (default: next to each input).", "dir");
+    const QCommandLineOption jobsOpt({"j", "jobs"}, "Files processed in parallel (default: core count).", "n");
+    const QCommandLineOption csvOpt("csv", "Write CSV only (default: CSV and JSON).");
+    const QCommandLineOption jsonOpt("json", "Write JSON only (default: CSV and JSON).");
+    const QCommandLineOption compactOpt("compact", "Compact (non-indented) JSON.");
+    const QCommandLineOption cacheOpt("cache", "Use and fill the binary dataset cache.");
+    const QCommandLineOption summaryOpt("summary", "Summary CSV path (default: <output>/summary.csv).", "file");
+    const QCommandLineOption memoryOpt("memory-limit", "Memory per file in MB; larger data is paged to disk.", "mb");
+    const QCommandLineOption compressOpt("compress", "Keep raw columns compressed in memory.");
+    const QCommandLineOption windowOpt("calibration-window", "Rolling calibration window in seconds (default: whole file).", "s");
+    const QCommandLineOption resampleOpt("resample", "Export averages on a fixed time grid with this step in seconds.", "s");
+    const QCommandLineOption anomalousOpt("exclude-anomalous", "Leave sensors flagged as flat, saturated, spiky or dropping out of the calibration reference.");
+    const QCommandLineOption correlationOpt("correlation", "Add the channel correlation matrix to the JSON statistics.");
+    const QCommandLineOption columnsOpt("columns", "Also write binary columns (.scol) for numpy/pandas.");
+    const QCommandLineOption sessionOpt("session", "Load all inputs as one session: concat (stitch by time) or overlay (side by side).", "mode");
+    const QCommandLineOption traceOpt("trace", "Write per-stage timings as a Chrome trace-event JSON.", "file");
+    parser.addOptions({outputOpt, jobsOpt, csvOpt, jsonOpt, compactOpt, cacheOpt, summaryOpt, memoryOpt,
+                       compressOpt, windowOpt, anomalousOpt, resampleOpt, columnsOpt, correlationOpt, sessionOpt, traceOpt});
+    parser.process(app);
+
+    const QStringList files = collectInputs(parser.positionalArguments());
+    if (files.isEmpty()) {
+        std::fprintf(stderr, "No input files.\n\n%s", qPrintable(parser.helpText()));
+        return 2;
+    }
+
+    BatchOptions options;
+    options.outputDir = parser.value(outputOpt);
+    if (!options.outputDir.isEmpty() && !QDir().mkpath(options.outputDir)) {
+        std::fprintf(stderr, "Cannot create output directory: %s\n", qPrintable(options.outputDir));
+        return 2;
+    }
+    if (parser.isSet(csvOpt) != parser.isSet(jsonOpt)) {
+        options.csv = parser.isSet(csvOpt);
+        options.json = parser.isSet(jsonOpt);
+    }
+    options.compact = parser.isSet(compactOpt);
+    options.columns = parser.isSet(columnsOpt);
+    options.correlation = parser.isSet(correlationOpt);
+    options.useCache = parser.isSet(cacheOpt);
+    options.storage.memoryLimit = qMax(0LL, parser.value(memoryOpt).toLongLong()) * 1024 * 1024;
+    options.storage.compress = parser.isSet(compressOpt);
+    options.calibrationWindow = qMax(0.0, parser.value(windowOpt).toDouble());
+    options.excludeAnomalous = parser.isSet(anomalousOpt);
+    options.step = qMax(0.0, parser.value(resampleOpt).toDouble());
+
+    // Файлов больше, чем ядер - каждый файл в один поток; файлов мало - ядра делятся между ними
+    const int cores = qMax(1, QThread::idealThreadCount());
+    const int jobs = qBound(1, parser.isSet(jobsOpt) ? parser.value(jobsOpt).toInt() : cores, int(files.size()));
+    options.parseThreads = qMax(1, cores / jobs);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobs);
+
+    const QString session = parser.value(sessionOpt);
+    if (!session.isEmpty() && session != "concat" && session != "overlay") {
+        std::fprintf(stderr, "Unknown session mode: %s (expected concat or overlay)\n", qPrintable(session));
+        return 2;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<FileResult> results;
+    if (!session.isEmpty()) {
+        // Сессия сама делит ядра между файлами
+        options.parseThreads = cores;
+        results << processSession(files, session == "overlay" ? SessionMode::Overlay : SessionMode::Concatenate,
+                                  options);
+    } else {
+        results = QtConcurrent::blockingMapped<QList<FileResult>>(
+            &pool, files, [&options](const QString &path) { return processFile(path, options); });
+    }
+
+    const QString summaryPath = parser.isSet(summaryOpt)
+                                    ? parser.value(summaryOpt)
+                                    : QDir(options.outputDir.isEmpty() ? QFileInfo(files.first()).absolutePath()
+                                                                       : options.outputDir).filePath("summary.csv");
+    const bool summaryOk = writeSummary(summaryPath, results);
+    if (parser.isSet(traceOpt)) Tracer::instance().writeChromeTrace(parser.value(traceOpt));
+
+    int failed = 0;
+    qint64 rows = 0;
+    for (const FileResult &r : results) {
+        if (!r.ok) ++failed;
+        rows += r.rows;
+    }
+    qInfo().noquote() << QString("%1 files (%2 failed), %3 rows in %4 ms with %5 jobs; summary: %6")
+                             .arg(results.size()).arg(failed).arg(rows).arg(timer.elapsed()).arg(jobs).arg(summaryPath);
+    return (failed == 0 && summaryOk) ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+#include "columncodec.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+enum FrameKind : char { RawFrame = 0, PackedFrame = 1 };
+
+constexpr int kMaxScale = 6;
+constexpr double kPow10[kMaxScale + 1] = {1.0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6};
+// Целые до 2^50: разности и zigzag влезают в 53 бита, поле читается одним 64-битным словом
+constexpr double kMaxInteger = 1125899906842624.0;
+constexpr int kMaxWidth = 56;
+constexpr qsizetype kPackedHeader = 3 + 8; // вид, scale, width, base
+constexpr qsizetype kTailPadding = 8;      // распаковка читает по 8 байт
+
+quint64 zigzag(qint64 v) { return (quint64(v) << 1) ^ quint64(v >> 63); }
+qint64 unzigzag(quint64 v) { return qint64(v >> 1) ^ -qint64(v & 1); }
+
+// Наименьший scale, при котором все отсчеты кадра - целые после умножения на 10^scale;
+// -1, если такого нет
+int frameScale(const RawSample *data, qsizetype count) {
+    for (int scale = 0; scale <= kMaxScale; ++scale) {
+        const double mul = kPow10[scale];
+        bool exact = true;
+        for (qsizetype i = 0; i < count && exact; ++i) {
+            const RawSample v = data[i];
+            if (isGap(v)) continue;
+            const double x = double(v) * mul;
+            // -0 после округления стал бы +0
+            exact = std::fabs(x) < kMaxInteger && RawSample(double(std::llround(x)) / mul) == v
+                    && !(v == 0 && std::signbit(v));
+        }
+        if (exact) return scale;
+    }
+    return -1;
+}
+
+void appendRaw(QByteArray &out, const RawSample *data, qsizetype count) {
+    out.append(char(RawFrame));
+    out.append(reinterpret_cast<const char *>(data), count * qsizetype(sizeof(RawSample)));
+}
+
+void appendFrame(QByteArray &out, const RawSample *data, qsizetype count) {
+    const int scale = frameScale(data, count);
+    if (scale < 0) {
+        appendRaw(out, data, count);
+        return;
+    }
+
+    const double mul = kPow10[scale];
+    qint64 base = 0;
+    for (qsizetype i = 0; i < count; ++i) {
+        if (!isGap(data[i])) {
+            base = std::llround(double(data[i]) * mul);
+            break;
+        }
+    }
+
+    quint64 codes[ColumnCodec::kFrame];
+    quint64 maxCode = 0;
+    qint64 prev = base;
+    for (qsizetype i = 0; i < count; ++i) {
+        if (isGap(data[i])) {
+            codes[i] = 0;
+            continue;
+        }
+        const qint64 q = std::llround(double(data[i]) * mul);
+        codes[i] = zigzag(q - prev) + 1;
+        maxCode = std::max(maxCode, codes[i]);
+        prev = q;
+    }
+
+    int width = 0;
+    while (width < 64 && (maxCode >> width) != 0) ++width;
+    const qsizetype packedBytes = (count * width + 7) / 8;
+    if (width > kMaxWidth || kPackedHeader + packedBytes >= 1 + count * qsizetype(sizeof(RawSample))) {
+        appendRaw(out, data, count);
+        return;
+    }
+
+    const qsizetype at = out.size();
+    out.resize(at + kPackedHeader + packedBytes);
+    char *p = out.data() + at;
+    p[0] = char(PackedFrame);
+    p[1] = char(scale);
+    p[2] = char(width);
+    qToLittleEndian<qint64>(base, p + 3);
+
+    uchar *bits = reinterpret_cast<uchar *>(p + kPackedHeader);
+    std::memset(bits, 0, size_t(packedBytes));
+    quint64 bit = 0;
+    for (qsizetype i = 0; i < count; ++i, bit += width) {
+        // Поле до 56 бит со сдвигом до 7 - не больше 8 байт
+        quint64 v = codes[i] << (bit & 7);
+        for (uchar *b = bits + (bit >> 3); v != 0; v >>= 8) *b++ |= uchar(v);
+    }
+}
+
+} // namespace
+
+QByteArray ColumnCodec::encode(const RawSample *data, qsizetype count) {
+    QByteArray out;
+    out.reserve(count * qsizetype(sizeof(RawSample)) / 4);
+    for (qsizetype i = 0; i < count; i += kFrame) appendFrame(out, data + i, std::min(kFrame, count - i));
+    out.append(kTailPadding, '\0');
+    out.squeeze();
+    return out;
+}
+
+bool ColumnCodec::decode(const QByteArray &blob, RawSample *out, qsizetype count) {
+    const uchar *p = reinterpret_cast<const uchar *>(blob.constData());
+    const uchar *end = p + blob.size() - kTailPadding;
+
+    for (qsizetype i = 0; i < count; i += kFrame) {
+        const qsizetype n = std::min(kFrame, count - i);
+        if (p >= end) return false;
+
+        if (*p == RawFrame) {
+            const qsizetype bytes = n * qsizetype(sizeof(RawSample));
+            if (end - p < 1 + bytes) return false;
+            std::memcpy(out + i, p + 1, size_t(bytes));
+            p += 1 + bytes;
+            continue;
+        }
+
+        if (end - p < kPackedHeader || p[0] != PackedFrame || p[1] > kMaxScale || p[2] > kMaxWidth) return false;
+        const double mul = kPow10[p[1]];
+        const int width = p[2];
+        qint64 acc = qFromLittleEndian<qint64>(p + 3);
+        const uchar *bits = p + kPackedHeader;
+        const qsizetype packedBytes = (n * width + 7) / 8;
+        if (end - bits < packedBytes) return false;
+
+        const quint64 mask = (quint64(1) << width) - 1;
+        RawSample *dst = out + i;
+        quint64 bit = 0;
+        for (qsizetype k = 0; k < n; ++k, bit += width) {
+            const quint64 code = (qFromLittleEndian<quint64>(bits + (bit >> 3)) >> (bit & 7)) & mask;
+            if (code == 0) {
+                dst[k] = gapSample();
+                continue;
+            }
+            acc += unzigzag(code - 1);
+            dst[k] = RawSample(p[1] == 0 ? double(acc) : double(acc) / mul);
+        }
+        p = bits + packedBytes;
+    }
+    return true;
+}
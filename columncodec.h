@@ -0,0 +1,26 @@
+#ifndef COLUMNCODEC_H
+#define COLUMNCODEC_H
+
+#include <QByteArray>
+
+#include "rawsample.h"
+
+// Сжатие кусков колонки сырых отсчетов.
+//
+// Отсчеты - это счетчики (или числа с парой знаков после запятой) и меняются
+// медленно, поэтому кусок режется на кадры по kFrame отсчетов, каждый кадр
+// переводится в целые (v * 10^scale без потерь), и пишутся упакованные в
+// width бит разности соседних значений (zigzag). Пропуск - код 0.
+// Кадр, который так не ложится (дробные значения, огромный разброс), хранится
+// как есть. Распаковка - один проход без ветвлений по ширине поля.
+class ColumnCodec
+{
+public:
+    static constexpr qsizetype kFrame = 1024;
+
+    static QByteArray encode(const RawSample *data, qsizetype count);
+    // out - ровно count отсчетов, count тот же, что при сжатии
+    static bool decode(const QByteArray &blob, RawSample *out, qsizetype count);
+};
+
+#endif // COLUMNCODEC_H
@@ -0,0 +1,200 @@
+#include "columnexporter.h"
+#include "taskcontrol.h"
+#include "tracer.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QtEndian>
+#include <QDebug>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'S', 'C', 'O', 'L', 'v', '1', '\0'};
+constexpr qint64 kPrefix = 16; // магия + длина заголовка
+
+enum class Kind { Time, Raw, Corrected };
+
+// Колонка файла и откуда ее брать
+struct Column {
+    QString name;
+    Kind kind;
+    const Sensor *sensor = nullptr;
+    int channel = 0;
+    qint64 offset = 0;
+
+    qint64 elementSize() const { return kind == Kind::Raw ? qint64(sizeof(RawSample)) : qint64(sizeof(double)); }
+    const char *type() const { return elementSize() == 4 ? "float32" : "float64"; }
+};
+
+qint64 alignUp(qint64 v, qint64 align) {
+    return (v + align - 1) / align * align;
+}
+
+// Пишет count значений v (NaN-заполнение строк вне датчика) - кусками из готового буфера
+template <typename T>
+bool writeFill(QFile &file, T v, qsizetype count) {
+    static constexpr qsizetype kFill = 8192;
+    const QVector<T> fill(std::min(count, kFill), v);
+    while (count > 0) {
+        const qsizetype n = std::min(count, fill.size());
+        const qint64 bytes = n * qint64(sizeof(T));
+        if (file.write(reinterpret_cast<const char *>(fill.constData()), bytes) != bytes) return false;
+        count -= n;
+    }
+    return true;
+}
+
+template <typename T>
+bool writeArray(QFile &file, const T *data, qsizetype count) {
+    const qint64 bytes = count * qint64(sizeof(T));
+    return file.write(reinterpret_cast<const char *>(data), bytes) == bytes;
+}
+
+QByteArray header(const SensorDataset &dataset, const QVector<Column> &columns) {
+    QJsonArray columnList;
+    for (const Column &c : columns) {
+        columnList.append(QJsonObject{{"name", c.name},
+                                      {"type", c.type()},
+                                      {"offset", c.offset},
+                                      {"length", qint64(dataset.time.size())}});
+    }
+
+    QJsonArray sensorList;
+    for (const Sensor &s : dataset.sensors) {
+        const QString p = s.name + '.';
+        sensorList.append(QJsonObject{{"id", s.id},
+                                      {"name", s.name},
+                                      {"coeff_A", s.kA},
+                                      {"coeff_B", s.kB},
+                                      {"first_row", qint64(s.offset)},
+                                      {"rows", qint64(s.size())},
+                                      {"columns", QJsonArray{p + "raw_A", p + "raw_B", p + "corr_A", p + "corr_B"}}});
+    }
+
+    const QJsonObject root{
+        {"format", "solarsensors-columns"},
+        {"version", 1},
+        {"byte_order", QSysInfo::ByteOrder == QSysInfo::LittleEndian ? "little" : "big"},
+        {"rows", qint64(dataset.time.size())},
+        {"global_reference", dataset.globalReference},
+        {"average_system_deviation_percent", dataset.avgDeviation * 100.0},
+        {"rolling_window_seconds", dataset.rolling.isActive() ? dataset.rolling.window : 0.0},
+        {"columns", columnList},
+        {"sensors", sensorList},
+    };
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+} // namespace
+
+bool ColumnExporter::write(const SensorDataset &dataset, const QString &path, TaskControl *control) {
+    TraceScope trace("exportColumns", "export");
+    const qsizetype rows = dataset.time.size();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    QVector<Column> columns;
+    columns.append({"time", Kind::Time});
+    for (const Sensor &s : dataset.sensors) {
+        columns.append({s.name + ".raw_A", Kind::Raw, &s, 0});
+        columns.append({s.name + ".raw_B", Kind::Raw, &s, 1});
+        columns.append({s.name + ".corr_A", Kind::Corrected, &s, 0});
+        columns.append({s.name + ".corr_B", Kind::Corrected, &s, 1});
+    }
+
+    // Смещения колонок - в заголовке, а длина заголовка - от смещений: растим начало
+    // данных, пока заголовок в него не влезет (обычно хватает двух проходов)
+    QByteArray head;
+    qint64 dataStart = 0;
+    for (;;) {
+        qint64 at = dataStart;
+        for (Column &c : columns) {
+            c.offset = at;
+            at = alignUp(at + rows * c.elementSize(), kAlign);
+        }
+        head = header(dataset, columns);
+        const qint64 needed = alignUp(kPrefix + head.size(), kAlign);
+        if (needed <= dataStart) break;
+        dataStart = needed;
+    }
+    head.append(QByteArray(dataStart - kPrefix - head.size(), ' '));
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to save columns:" << path;
+        return false;
+    }
+
+    // Длина заголовка - всегда little endian: byte_order внутри заголовка, его без длины не прочесть
+    const quint64 headSize = qToLittleEndian(quint64(head.size()));
+    bool ok = file.write(kMagic, sizeof(kMagic)) == qint64(sizeof(kMagic))
+              && file.write(reinterpret_cast<const char *>(&headSize), sizeof(headSize)) == qint64(sizeof(headSize))
+              && file.write(head) == head.size();
+    if (control) control->setTotal(columns.size());
+
+    QVector<double> corrected(kBlockSamples);
+    for (const Column &c : columns) {
+        if (!ok || (control && control->isCanceled())) break;
+        ok = writeFill<char>(file, '\0', qsizetype(c.offset - file.pos()));
+
+        if (c.kind == Kind::Time) {
+            ok = ok && writeArray(file, dataset.time.constData(), rows);
+            if (control) control->addDone(1);
+            continue;
+        }
+
+        // Строки до датчика, его отсчеты, строки после - NaN
+        const Sensor &s = *c.sensor;
+        const SampleColumn &raw = (c.channel == 0) ? s.rawA : s.rawB;
+        const qsizetype before = std::min(s.offset, rows);
+        const qsizetype count = std::min(s.size(), rows - before);
+        const qsizetype after = rows - before - count;
+
+        if (c.kind == Kind::Raw) {
+            ok = ok && writeFill<RawSample>(file, gapSample(), before);
+            // Колонка в памяти - один кусок, на диске - по кускам хранилища: без копий
+            raw.forEachSpan(0, count, [&](const RawSample *data, qsizetype, qsizetype n) {
+                ok = ok && writeArray(file, data, n);
+            });
+            ok = ok && writeFill<RawSample>(file, gapSample(), after);
+        } else {
+            ok = ok && writeFill<double>(file, nan, before);
+            const double k = (c.channel == 0) ? s.kA : s.kB;
+            const bool rolling = dataset.rolling.isActive();
+            raw.forEachSpan(0, count, [&](const RawSample *data, qsizetype first, qsizetype n) {
+                for (qsizetype from = 0; from < n && ok; from += kBlockSamples) {
+                    const qsizetype m = std::min(kBlockSamples, n - from);
+                    double *out = corrected.data();
+                    // NaN * k = NaN: пропуски остаются пропусками
+                    if (!rolling) {
+                        for (qsizetype j = 0; j < m; ++j) out[j] = double(data[from + j]) * k;
+                    } else {
+                        for (qsizetype j = 0; j < m; ++j)
+                            out[j] = double(data[from + j]) * dataset.coefficient(s, c.channel, first + from + j);
+                    }
+                    ok = writeArray(file, out, m);
+                }
+            });
+            ok = ok && writeFill<double>(file, nan, after);
+        }
+        if (control) control->addDone(1);
+    }
+
+    ok = ok && !dataset.storageFailed();
+    const qint64 written = file.pos();
+    file.close();
+    if (!ok || (control && control->isCanceled())) {
+        file.remove();
+        if (!ok) qWarning() << "Failed to save columns:" << path;
+        return false;
+    }
+    trace.setBytes(written);
+    trace.setRows(rows);
+    qInfo() << "Exported columns to:" << path;
+    return true;
+}
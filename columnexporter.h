@@ -0,0 +1,43 @@
+#ifndef COLUMNEXPORTER_H
+#define COLUMNEXPORTER_H
+
+#include <QString>
+
+#include "sensordata.h"
+
+class TaskControl;
+
+// Экспорт в бинарный колоночный формат (.scol) для анализа вне приложения:
+// колонки читаются через mmap без всякого разбора.
+//
+// Файл:
+//   0   8 байт   "SSCOLv1\0"
+//   8   8 байт   длина заголовка H (uint64, little endian)
+//   16  H байт   заголовок - JSON (UTF-8), дополнен пробелами
+//   ... колонки, каждая с позиции, кратной 64 байтам
+//
+// Заголовок: rows, byte_order, global_reference, average_system_deviation_percent,
+// rolling_window_seconds, columns[] { name, type (float32|float64), offset (от начала
+// файла), length (элементов) } и sensors[] { id, name, coeff_A, coeff_B, first_row,
+// rows, columns[] }. Все колонки - на общей оси времени (длина rows): колонка
+// "time", у датчика "<name>.raw_A", "<name>.raw_B", "<name>.corr_A", "<name>.corr_B";
+// пропуски и строки вне датчика - NaN. Сырые колонки - в типе RawSample (float32
+// при SOLAR_RAW_FLOAT32), скорректированные - float64.
+//
+// Чтение в Python (numpy):
+//   head = open(path, 'rb').read(16); n = int.from_bytes(head[8:], 'little')
+//   meta = json.loads(open(path, 'rb').read(16 + n)[16:])
+//   cols = {c['name']: np.memmap(path, dtype='<f4' if c['type'] == 'float32' else '<f8',
+//                                mode='r', offset=c['offset'], shape=(c['length'],))
+//           for c in meta['columns']}
+class ColumnExporter
+{
+public:
+    static bool write(const SensorDataset &dataset, const QString &path, TaskControl *control = nullptr);
+
+private:
+    static constexpr qint64 kAlign = 64;
+    static constexpr qsizetype kBlockSamples = 65536; // отсчетов в буфере пересчета corr
+};
+
+#endif // COLUMNEXPORTER_H
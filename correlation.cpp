@@ -0,0 +1,181 @@
+#include "correlation.h"
+#include "taskcontrol.h"
+#include "tracer.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+constexpr int kLanes = 4;
+
+// Канал матрицы: колонка датчика и ее среднее
+struct Channel {
+    const Sensor *sensor;
+    const SampleColumn *column;
+    double mean;
+};
+
+// Пара плиток (ti <= tj): задача заполняет строки ti-й плитки в столбцах tj-й
+struct TilePair {
+    qsizetype ti;
+    qsizetype tj;
+};
+
+// Суммы пары каналов i, j по строкам, где есть оба: x - канал i, y - канал j
+struct PairSums {
+    double count = 0.0;
+    double x = 0.0;
+    double y = 0.0;
+    double xx = 0.0;
+    double yy = 0.0;
+    double xy = 0.0;
+};
+
+double laneSum(const double *acc) {
+    return (acc[0] + acc[2]) + (acc[1] + acc[3]);
+}
+
+// Полоса канала: x - отсчет минус среднее канала, m - 1 у отсчета и 0 у пропуска,
+// q = x^2 (у пропуска x = q = 0). Маска другого канала отбирает общие строки
+void addPairSums(const double *xi, const double *mi, const double *qi, const double *xj, const double *mj,
+                 const double *qj, qsizetype n, PairSums &s) {
+    double c[kLanes] = {}, x[kLanes] = {}, y[kLanes] = {}, xx[kLanes] = {}, yy[kLanes] = {}, xy[kLanes] = {};
+    qsizetype r = 0;
+    for (; r + kLanes <= n; r += kLanes) {
+        for (int l = 0; l < kLanes; ++l) {
+            const qsizetype k = r + l;
+            c[l] += mi[k] * mj[k];
+            x[l] += xi[k] * mj[k];
+            y[l] += mi[k] * xj[k];
+            xx[l] += qi[k] * mj[k];
+            yy[l] += mi[k] * qj[k];
+            xy[l] += xi[k] * xj[k];
+        }
+    }
+    for (int l = 0; r < n; ++r, ++l) {
+        c[l] += mi[r] * mj[r];
+        x[l] += xi[r] * mj[r];
+        y[l] += mi[r] * xj[r];
+        xx[l] += qi[r] * mj[r];
+        yy[l] += mi[r] * qj[r];
+        xy[l] += xi[r] * xj[r];
+    }
+    s.count += laneSum(c);
+    s.x += laneSum(x);
+    s.y += laneSum(y);
+    s.xx += laneSum(xx);
+    s.yy += laneSum(yy);
+    s.xy += laneSum(xy);
+}
+
+// Пирсон по общим строкам; NaN - меньше двух общих строк или у канала на них нет разброса.
+// Разброс меньше kFlatVariance от суммы квадратов - ошибка округления постоянного канала
+double pearson(const PairSums &s) {
+    constexpr double kFlatVariance = 1e-12;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    if (s.count < 2.0) return nan;
+    const double vx = s.xx - s.x * s.x / s.count;
+    const double vy = s.yy - s.y * s.y / s.count;
+    if (!(vx > kFlatVariance * s.xx) || !(vy > kFlatVariance * s.yy)) return nan;
+    const double cov = s.xy - s.x * s.y / s.count;
+    return std::clamp(cov / std::sqrt(vx * vy), -1.0, 1.0);
+}
+
+} // namespace
+
+bool CorrelationEngine::compute(const SensorDataset &dataset, CorrelationMatrix &result, TaskControl *control) {
+    TraceScope trace("correlation", "analysis");
+    result = CorrelationMatrix();
+
+    QVector<Channel> channels;
+    channels.reserve(dataset.sensors.size() * 2);
+    for (const Sensor &s : dataset.sensors) {
+        channels.append({&s, &s.rawA, s.statsA.mean()});
+        channels.append({&s, &s.rawB, s.statsB.mean()});
+        result.channels << QString("S%1_A").arg(s.id) << QString("S%1_B").arg(s.id);
+    }
+    const qsizetype n = channels.size();
+    const qsizetype rows = dataset.time.size();
+    if (n == 0) return true;
+
+    QVector<TilePair> pairs;
+    const qsizetype tiles = (n + kTile - 1) / kTile;
+    for (qsizetype ti = 0; ti < tiles; ++ti) {
+        for (qsizetype tj = ti; tj < tiles; ++tj) pairs.append({ti, tj});
+    }
+
+    QVector<PairSums> sums(n * n);
+    QVector<double> slabX(n * kSlabRows), slabM(n * kSlabRows), slabQ(n * kSlabRows);
+    QVector<qsizetype> order(n);
+    std::iota(order.begin(), order.end(), qsizetype(0));
+    if (control) control->setTotal(rows);
+
+    for (qsizetype r0 = 0; r0 < rows; r0 += kSlabRows) {
+        if (control && control->isCanceled()) return false;
+        const qsizetype len = std::min(kSlabRows, rows - r0);
+
+        // Упаковка: пропуски и строки вне датчика - нули во всех трех полосах
+        double *px = slabX.data();
+        double *pm = slabM.data();
+        double *pq = slabQ.data();
+        QtConcurrent::blockingMap(order, [&](qsizetype c) {
+            const Channel &ch = channels[c];
+            double *x = px + c * kSlabRows;
+            double *m = pm + c * kSlabRows;
+            double *q = pq + c * kSlabRows;
+            std::fill(x, x + len, 0.0);
+            std::fill(m, m + len, 0.0);
+            std::fill(q, q + len, 0.0);
+            const qsizetype first = std::clamp(r0 - ch.sensor->offset, qsizetype(0), ch.sensor->size());
+            const qsizetype last = std::clamp(r0 + len - ch.sensor->offset, qsizetype(0), ch.sensor->size());
+            const qsizetype shift = ch.sensor->offset - r0;
+            const double mean = ch.mean;
+            ch.column->forEachSpan(first, last, [&](const RawSample *data, qsizetype from, qsizetype count) {
+                const qsizetype at = from + shift;
+                for (qsizetype k = 0; k < count; ++k) {
+                    const double v = double(data[k]);
+                    if (v != v) continue;
+                    x[at + k] = v - mean;
+                    m[at + k] = 1.0;
+                    q[at + k] = (v - mean) * (v - mean);
+                }
+            });
+        });
+
+        // Пары плиток; на диагонали - только верхний треугольник
+        PairSums *out = sums.data();
+        QtConcurrent::blockingMap(pairs, [&](const TilePair &p) {
+            const qsizetype i0 = p.ti * kTile, i1 = std::min(n, i0 + kTile);
+            const qsizetype j0 = p.tj * kTile, j1 = std::min(n, j0 + kTile);
+            for (qsizetype i = i0; i < i1; ++i) {
+                const qsizetype oi = i * kSlabRows;
+                for (qsizetype j = (p.ti == p.tj) ? i : j0; j < j1; ++j) {
+                    const qsizetype oj = j * kSlabRows;
+                    addPairSums(px + oi, pm + oi, pq + oi, px + oj, pm + oj, pq + oj, len, out[i * n + j]);
+                }
+            }
+        });
+        if (control) control->addDone(len);
+    }
+
+    // Верхний треугольник -> симметричная матрица корреляций
+    result.values.resize(n * n);
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (qsizetype i = 0; i < n; ++i) {
+        result.values[i * n + i] = std::isnan(pearson(sums[i * n + i])) ? nan : 1.0;
+        for (qsizetype j = i + 1; j < n; ++j) {
+            const double r = pearson(sums[i * n + j]);
+            result.values[i * n + j] = r;
+            result.values[j * n + i] = r;
+        }
+    }
+    if (dataset.storageFailed()) return false;
+    trace.setRows(rows);
+    trace.setBytes(qint64(rows) * n * qint64(sizeof(RawSample)));
+    return true;
+}
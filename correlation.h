@@ -0,0 +1,45 @@
+#ifndef CORRELATION_H
+#define CORRELATION_H
+
+#include <QStringList>
+#include <QVector>
+
+#include "sensordata.h"
+
+class TaskControl;
+
+// Корреляции Пирсона между всеми каналами набора. Каналы - по порядку датчиков,
+// у каждого A, затем B ("S<id>_A", "S<id>_B").
+struct CorrelationMatrix {
+    QStringList channels;
+    QVector<double> values; // size() x size() по строкам; NaN - меньше двух общих строк или нет разброса на них
+
+    qsizetype size() const { return channels.size(); }
+    bool isEmpty() const { return channels.isEmpty(); }
+    double at(qsizetype i, qsizetype j) const { return values[i * size() + j]; }
+};
+
+// r_ij - Пирсон по сырым отсчетам (коэффициент калибровки на корреляцию не влияет)
+// только на строках, где есть отсчеты обоих каналов: пропуски и строки вне датчика
+// в суммы пары не входят. Для каждой пары копятся число общих строк, суммы x, y,
+// x^2, y^2 и xy по ним; отсчеты заранее сдвинуты на среднее канала (statsA/statsB),
+// чтобы суммы квадратов не теряли точность.
+//
+// Строки идут полосами по kSlabRows: полоса упаковывается в буферы "канал x строка"
+// (отсчет, маска, квадрат; параллельно по каналам, колонки на диске читаются по
+// кускам), затем пары плиток по kTile каналов считаются параллельно. Внутренний цикл -
+// скалярный, на 4 независимые суммы на величину; компилятор векторизует его без
+// -ffast-math, интринсиков нет. Каждая плитка матрицы принадлежит одной задаче и
+// суммируется по полосам в одном порядке, поэтому результат не зависит от числа
+// потоков. Память - O(каналов * kSlabRows + каналов^2).
+class CorrelationEngine
+{
+public:
+    static constexpr qsizetype kSlabRows = 1024;
+    static constexpr qsizetype kTile = 16;
+
+    // control: прогресс в строках и отмена; при отмене или ошибке хранилища колонок возвращает false
+    static bool compute(const SensorDataset &dataset, CorrelationMatrix &result, TaskControl *control = nullptr);
+};
+
+#endif // CORRELATION_H
@@ -0,0 +1,42 @@
+#include "correlationmodel.h"
+
+CorrelationModel::CorrelationModel(QObject *parent) : QAbstractTableModel(parent) {}
+
+int CorrelationModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : channelCount();
+}
+
+int CorrelationModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : channelCount();
+}
+
+QVariant CorrelationModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= channelCount() || index.column() >= channelCount()) return {};
+    switch (role) {
+    case Qt::DisplayRole:
+    case ValueRole: return m_matrix.at(index.row(), index.column());
+    case RowNameRole: return m_matrix.channels.at(index.row());
+    case ColumnNameRole: return m_matrix.channels.at(index.column());
+    default: return {};
+    }
+}
+
+QVariant CorrelationModel::headerData(int section, Qt::Orientation, int role) const {
+    if (role != Qt::DisplayRole || section < 0 || section >= channelCount()) return {};
+    return m_matrix.channels.at(section);
+}
+
+QHash<int, QByteArray> CorrelationModel::roleNames() const {
+    QHash<int, QByteArray> roles;
+    roles[ValueRole] = "value";
+    roles[RowNameRole] = "rowName";
+    roles[ColumnNameRole] = "columnName";
+    return roles;
+}
+
+void CorrelationModel::setMatrix(const CorrelationMatrix &matrix) {
+    beginResetModel();
+    m_matrix = matrix;
+    endResetModel();
+    emit matrixChanged();
+}
@@ -0,0 +1,37 @@
+#ifndef CORRELATIONMODEL_H
+#define CORRELATIONMODEL_H
+
+#include <QAbstractTableModel>
+
+#include "correlation.h"
+
+// Матрица корреляций для тепловой карты (TableView): ячейка (i, j) - r каналов i и j.
+// Роли: value (r, NaN - нет данных), rowName/columnName - "S<id>_A|B"
+class CorrelationModel : public QAbstractTableModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int channelCount READ channelCount NOTIFY matrixChanged)
+
+public:
+    enum Roles { ValueRole = Qt::UserRole + 1, RowNameRole, ColumnNameRole };
+
+    explicit CorrelationModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int channelCount() const { return int(m_matrix.size()); }
+    const CorrelationMatrix &matrix() const { return m_matrix; }
+    void setMatrix(const CorrelationMatrix &matrix);
+
+signals:
+    void matrixChanged();
+
+private:
+    CorrelationMatrix m_matrix;
+};
+
+#endif // CORRELATIONMODEL_H
@@ -0,0 +1,219 @@
+#include "csvexporter.h"
+#include "taskcontrol.h"
+#include "tracer.h"
+
+#include <QFile>
+#include <QThread>
+#include <QDebug>
+#include <QtMath>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <charconv>
+
+namespace {
+
+// Блок строк общей оси времени (или узлов сетки) [from, to), отформатированный в text
+struct Block {
+    qsizetype from;
+    qsizetype to;
+    QByteArray text;
+};
+
+void appendFixed(QByteArray &out, double v, int precision) {
+    char buf[128];
+    std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::fixed, precision);
+    if (r.ec != std::errc()) r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, r.ptr - buf);
+}
+
+QByteArray fixed(double v, int precision) {
+    QByteArray out;
+    appendFixed(out, v, precision);
+    return out;
+}
+
+void formatBlock(const SensorDataset &dataset, const QVector<const Sensor *> &sensors,
+                 const CsvExporter::Options &options, Block &block) {
+    const int columns = (options.raw ? 2 : 0) + (options.corrected ? 2 : 0);
+    QByteArray &out = block.text;
+    out.reserve((block.to - block.from) * (12 + sensors.size() * columns * 10));
+
+    // Курсоры держат текущий кусок колонки на диске: строки идут по возрастанию
+    QVector<SampleColumn::Cursor> rawA, rawB;
+    for (const Sensor *s : sensors) {
+        rawA.append(SampleColumn::Cursor(s->rawA));
+        rawB.append(SampleColumn::Cursor(s->rawB));
+    }
+
+    for (qsizetype r = block.from; r < block.to; ++r) {
+        const qsizetype rowStart = out.size();
+        bool hasData = false;
+        appendFixed(out, dataset.time[r], 3);
+
+        for (qsizetype k = 0; k < sensors.size(); ++k) {
+            const Sensor *s = sensors.at(k);
+            const qsizetype i = r - s->offset;
+            const RawSample a = i >= 0 && i < s->size() ? rawA[k][i] : gapSample();
+            if (!isGap(a)) {
+                const RawSample b = rawB[k][i];
+                hasData = true;
+                if (options.raw) {
+                    out.append(';'); appendFixed(out, a, 0);            // Raw A
+                    out.append(';'); appendFixed(out, b, 0);            // Raw B
+                }
+                if (options.corrected) {
+                    out.append(';'); appendFixed(out, a * dataset.coefficient(*s, 0, i), 2); // Corr A
+                    out.append(';'); appendFixed(out, b * dataset.coefficient(*s, 1, i), 2); // Corr B
+                }
+            } else {
+                out.append(";;;;", columns); // Нет данных датчика в этой строке
+            }
+        }
+
+        // Строки, где нет ни одного выбранного датчика, не выгружаем
+        if (hasData) out.append('\n');
+        else out.truncate(rowStart);
+    }
+}
+
+// То же на сетке: строка - узел, в колонках средние отсчетов узла
+void formatGridBlock(const SensorDataset &dataset, const TimeGrid &grid, const QVector<const Sensor *> &sensors,
+                     const CsvExporter::Options &options, Block &block) {
+    const int columns = (options.raw ? 2 : 0) + (options.corrected ? 2 : 0);
+    QByteArray &out = block.text;
+    out.reserve((block.to - block.from) * (12 + sensors.size() * columns * 12));
+
+    QVector<SampleColumn::Cursor> rawA, rawB;
+    for (const Sensor *s : sensors) {
+        rawA.append(SampleColumn::Cursor(s->rawA));
+        rawB.append(SampleColumn::Cursor(s->rawB));
+    }
+
+    GridSample v;
+    for (qsizetype e = block.from; e < block.to; ++e) {
+        const qsizetype rowStart = out.size();
+        bool hasData = false;
+        appendFixed(out, grid.times[e], 3);
+
+        for (qsizetype k = 0; k < sensors.size(); ++k) {
+            if (dataset.gridSample(*sensors.at(k), grid.rows[e], grid.rows[e + 1], rawA[k], rawB[k], v)) {
+                hasData = true;
+                if (options.raw) {
+                    out.append(';'); appendFixed(out, v.rawA, 2);
+                    out.append(';'); appendFixed(out, v.rawB, 2);
+                }
+                if (options.corrected) {
+                    out.append(';'); appendFixed(out, v.corrA, 2);
+                    out.append(';'); appendFixed(out, v.corrB, 2);
+                }
+            } else {
+                out.append(";;;;", columns);
+            }
+        }
+
+        if (hasData) out.append('\n');
+        else out.truncate(rowStart);
+    }
+}
+
+} // namespace
+
+bool CsvExporter::write(const SensorDataset &dataset, const QString &path, TaskControl *control,
+                        const Options &options) {
+    TraceScope trace("exportCsv", "export");
+    QVector<const Sensor *> sensors;
+    for (const Sensor &s : dataset.sensors) {
+        if (options.sensorIds.isEmpty() || options.sensorIds.contains(s.id)) sensors.append(&s);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Ошибка создания файла:" << path;
+        return false;
+    }
+
+    file.write("\xEF\xBB\xBF"); // UTF-8 BOM для Excel
+
+    if (sensors.isEmpty()) {
+        file.close();
+        return true;
+    }
+
+    const double avgDevPercent = dataset.avgDeviation * 100.0;
+
+    // Коэффициенты стоят над колонками Corr A / Corr B
+    QByteArray head;
+    for (const Sensor *s : sensors) {
+        if (options.raw) head.append(";;");
+        if (options.corrected) head.append(";x").append(fixed(s->kA, 4)).append(";x").append(fixed(s->kB, 4));
+    }
+    head.append(";;GLOBAL REFERENCE:;").append(fixed(dataset.globalReference, 2)).append('\n');
+
+    head.append("Time (s)");
+    for (const Sensor *s : sensors) {
+        const QByteArray p = s->name.toUtf8();
+        if (options.raw) head.append(';').append(p).append(" Raw A;").append(p).append(" Raw B");
+        if (options.corrected) head.append(';').append(p).append(" Corr A;").append(p).append(" Corr B");
+    }
+    head.append(";;AVG ERROR (%):;").append(fixed(avgDevPercent, 2)).append("%\n");
+
+    bool ok = file.write(head) == head.size();
+    qint64 written = head.size();
+
+    // Строки CSV - строки общей оси времени, ограниченные окном и выбранными датчиками
+    qsizetype rowFrom = dataset.time.size();
+    qsizetype rowTo = 0;
+    for (const Sensor *s : sensors) {
+        rowFrom = qMin(rowFrom, s->offset);
+        rowTo = qMax(rowTo, s->offset + s->size());
+    }
+    const double *t = dataset.time.constData();
+    rowFrom = std::max(rowFrom, qsizetype(std::lower_bound(t, t + rowTo, options.tFrom) - t));
+    rowTo = std::min(rowTo, qsizetype(std::upper_bound(t, t + rowTo, options.tTo) - t));
+
+    // С шагом блоки режутся по узлам сетки, а не по строкам
+    TimeGrid grid;
+    const bool resample = options.step > 0.0;
+    if (resample) dataset.buildGrid(options.step, rowFrom, rowTo, grid);
+    const qsizetype lines = resample ? grid.size() : qMax<qsizetype>(0, rowTo - rowFrom);
+    const qsizetype lineFrom = resample ? 0 : rowFrom;
+
+    QVector<Block> blocks;
+    for (qsizetype from = lineFrom; from < lineFrom + lines; from += kBlockRows)
+        blocks.append({from, qMin(lineFrom + lines, from + kBlockRows), QByteArray()});
+    if (control) control->setTotal(lines);
+
+    // Партиями по несколько блоков на поток: в памяти держится только партия
+    const qsizetype batchSize = qMax(1, QThread::idealThreadCount()) * 2;
+    for (qsizetype b = 0; b < blocks.size() && ok; b += batchSize) {
+        if (control && control->isCanceled()) {
+            file.close();
+            file.remove();
+            return false;
+        }
+
+        QVector<Block> batch = blocks.mid(b, batchSize);
+        QtConcurrent::blockingMap(batch, [&](Block &block) {
+            if (resample) formatGridBlock(dataset, grid, sensors, options, block);
+            else formatBlock(dataset, sensors, options, block);
+        });
+
+        for (const Block &block : batch) {
+            ok = ok && file.write(block.text) == block.text.size();
+            written += block.text.size();
+            if (control) control->addDone(block.to - block.from);
+        }
+    }
+
+    ok = ok && !dataset.storageFailed();
+    file.close();
+    if (!ok) {
+        file.remove();
+        qWarning() << "Ошибка записи файла:" << path;
+        return false;
+    }
+    trace.setBytes(written);
+    trace.setRows(lines);
+    return true;
+}
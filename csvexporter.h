@@ -0,0 +1,41 @@
+#ifndef CSVEXPORTER_H
+#define CSVEXPORTER_H
+
+#include <QString>
+#include <QVector>
+
+#include <limits>
+
+#include "sensordata.h"
+
+class TaskControl;
+
+// Какие колонки и строки выгружать. По умолчанию - все, как раньше.
+// (Вне класса: вложенную структуру с инициализаторами нельзя взять
+// аргументом по умолчанию внутри того же класса.)
+struct CsvExportOptions {
+    bool raw = true;         // Raw A / Raw B
+    bool corrected = true;   // Corr A / Corr B
+    QVector<int> sensorIds;  // пусто - все датчики
+    double tFrom = -std::numeric_limits<double>::infinity();
+    double tTo = std::numeric_limits<double>::infinity();
+    // > 0 - строки на сетке с этим шагом (с): в строке средние отсчетов узла
+    double step = 0.0;
+};
+
+// Экспорт набора данных в CSV (разделитель ';', UTF-8 BOM для Excel).
+// Работает с копией набора, поэтому может выполняться в рабочем потоке.
+// Строки форматируются блоками параллельно и пишутся крупными кусками.
+class CsvExporter
+{
+public:
+    using Options = CsvExportOptions;
+
+    static bool write(const SensorDataset &dataset, const QString &path, TaskControl *control = nullptr,
+                      const Options &options = Options());
+
+private:
+    static constexpr qsizetype kBlockRows = 16384;
+};
+
+#endif // CSVEXPORTER_H
@@ -0,0 +1,368 @@
+#include "datasetcache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+const char kMagic[8] = { 'S', 'S', 'D', 'A', 'T', 'A', 'S', 'T' };
+constexpr quint32 kVersion = 2; // 2: мониторы неисправностей каналов
+constexpr quint32 kByteOrderMark = 0x01020304;
+constexpr qint64 kHashSampleBytes = 1 << 20;
+
+struct FileHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    quint32 rawSampleSize;
+    quint32 sensorCount;
+    qint64 sourceSize;
+    qint64 sourceMtime;
+    char sourceHash[32];
+    qint64 rowCount;
+    double globalReference;
+    double minTime;
+    double maxTime;
+    double minValue;
+    double maxValue;
+};
+
+struct StatsRecord {
+    double sum;
+    double min;
+    double max;
+    qint64 count;
+};
+
+struct SensorRecord {
+    qint32 id;
+    qint32 nameBytes;
+    qint64 offset;
+    qint64 size;
+    double kA;
+    double kB;
+    StatsRecord statsA;
+    StatsRecord statsB;
+    StatsRecord statsTime;
+    ChannelMonitor monitorA;
+    ChannelMonitor monitorB;
+};
+
+static_assert(sizeof(FileHeader) % 8 == 0, "FileHeader must stay 8-byte aligned");
+static_assert(sizeof(SensorRecord) % 8 == 0, "SensorRecord must stay 8-byte aligned");
+static_assert(std::is_trivially_copyable_v<ChannelMonitor>, "ChannelMonitor is stored as is");
+static_assert(sizeof(LodPyramid::Bucket) == 8, "Bucket layout is part of the file format");
+
+inline qint64 padded(qint64 bytes) { return (bytes + 7) & ~qint64(7); }
+
+StatsRecord toRecord(const ChannelStats &s) { return { s.sum, s.min, s.max, qint64(s.count) }; }
+ChannelStats fromRecord(const StatsRecord &r) {
+    ChannelStats s;
+    s.sum = r.sum;
+    s.min = r.min;
+    s.max = r.max;
+    s.count = r.count;
+    return s;
+}
+
+bool writePadding(QSaveFile &file, qint64 bytes) {
+    static const char zeros[8] = {};
+    const qint64 pad = padded(bytes) - bytes;
+    return pad == 0 || file.write(zeros, pad) == pad;
+}
+
+// Запись блока с добивкой нулями до 8 байт
+bool writeBlock(QSaveFile &file, const void *data, qint64 bytes) {
+    if (bytes > 0 && file.write(static_cast<const char *>(data), bytes) != bytes) return false;
+    return writePadding(file, bytes);
+}
+
+// Колонка (в том числе с диска) пишется подряд теми же байтами, что и из памяти
+bool writeColumn(QSaveFile &file, const SampleColumn &column) {
+    bool ok = true;
+    column.forEachSpan(0, column.size(), [&](const RawSample *data, qsizetype, qsizetype count) {
+        const qint64 bytes = count * qint64(sizeof(RawSample));
+        ok = ok && file.write(reinterpret_cast<const char *>(data), bytes) == bytes;
+    });
+    return ok && writePadding(file, column.size() * qint64(sizeof(RawSample)));
+}
+
+bool writeLod(QSaveFile &file, const LodPyramid &lod) {
+    const QVector<QVector<LodPyramid::Bucket>> &levels = lod.levels();
+    const qint64 levelCount = levels.size();
+    if (!writeBlock(file, &levelCount, sizeof(levelCount))) return false;
+    for (const QVector<LodPyramid::Bucket> &level : levels) {
+        const qint64 n = level.size();
+        if (!writeBlock(file, &n, sizeof(n))) return false;
+        if (!writeBlock(file, level.constData(), n * qint64(sizeof(LodPyramid::Bucket)))) return false;
+    }
+    return true;
+}
+
+// Последовательное чтение из отображенного файла с проверкой границ
+class Reader
+{
+public:
+    Reader(const uchar *begin, qint64 size) : m_pos(begin), m_end(begin + size) {}
+
+    const uchar *take(qint64 bytes) {
+        const qint64 step = padded(bytes);
+        if (bytes < 0 || step > m_end - m_pos) return nullptr;
+        const uchar *p = m_pos;
+        m_pos += step;
+        return p;
+    }
+
+    template <typename T>
+    bool read(T &value) {
+        const uchar *p = take(sizeof(T));
+        if (!p) return false;
+        std::memcpy(&value, p, sizeof(T));
+        return true;
+    }
+
+    // store != nullptr - колонка копируется в хранилище, а не в память
+    bool readColumn(SampleColumn &out, qint64 count, const QSharedPointer<ChunkStore> &store) {
+        if (count < 0) return false;
+        const uchar *p = take(count * qint64(sizeof(RawSample)));
+        if (!p) return false;
+        out = store ? SampleColumn(store) : SampleColumn();
+        out.reserve(count);
+        // Отображенный файл выровнен на 8 байт, блоки тоже - отсчеты выровнены
+        out.append(reinterpret_cast<const RawSample *>(p), count);
+        return true;
+    }
+
+    template <typename T>
+    bool readArray(QVector<T> &out, qint64 count) {
+        if (count < 0) return false;
+        const uchar *p = take(count * qint64(sizeof(T)));
+        if (!p) return false;
+        out.resize(count);
+        if (count > 0) std::memcpy(out.data(), p, size_t(count) * sizeof(T));
+        return true;
+    }
+
+private:
+    const uchar *m_pos;
+    const uchar *m_end;
+};
+
+// Пирамида канала из count отсчетов. Файл мог быть обрезан или испорчен при
+// совпавшем ключе: индексы должны лежать в своей корзине (значит, и в колонке),
+// уровни - идти от ceil(count / kBaseBucket) вдвое вниз до одной корзины
+bool readLod(Reader &reader, LodPyramid &lod, qint64 count) {
+    qint64 levelCount = 0;
+    if (!reader.read(levelCount) || levelCount < 0 || levelCount > 64) return false;
+    QVector<QVector<LodPyramid::Bucket>> levels(levelCount);
+    qint64 expected = (count + LodPyramid::kBaseBucket - 1) / LodPyramid::kBaseBucket;
+    for (qint64 l = 0; l < levelCount; ++l) {
+        QVector<LodPyramid::Bucket> &level = levels[l];
+        qint64 n = 0;
+        if (!reader.read(n) || n != expected || !reader.readArray(level, n)) return false;
+
+        const qint64 bucketSize = LodPyramid::kBaseBucket << l;
+        for (qint64 i = 0; i < n; ++i) {
+            const LodPyramid::Bucket &b = level.at(i);
+            if ((b.minIndex == LodPyramid::kNoIndex) != (b.maxIndex == LodPyramid::kNoIndex)) return false;
+            if (b.minIndex == LodPyramid::kNoIndex) continue;
+            const qint64 first = i * bucketSize;
+            const qint64 last = std::min(first + bucketSize, count);
+            if (qint64(b.minIndex) < first || qint64(b.minIndex) >= last || qint64(b.maxIndex) < first
+                || qint64(b.maxIndex) >= last)
+                return false;
+        }
+        // Сборка останавливается на уровне из одной корзины
+        if ((n == 1) != (l == levelCount - 1)) return false;
+        expected = (n + 1) / 2;
+    }
+    lod.setLevels(levels);
+    return true;
+}
+
+} // namespace
+
+DatasetCache::SourceKey DatasetCache::sourceKey(const QString &txtPath) {
+    SourceKey key;
+    QFile file(txtPath);
+    if (!file.open(QIODevice::ReadOnly)) return key;
+
+    key.size = file.size();
+    key.mtime = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+
+    // Полный хэш многомегабайтного файла съел бы весь выигрыш - берем края
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(QByteArray::number(key.size));
+    hash.addData(file.read(kHashSampleBytes));
+    if (key.size > 2 * kHashSampleBytes) {
+        file.seek(key.size - kHashSampleBytes);
+        hash.addData(file.read(kHashSampleBytes));
+    } else {
+        hash.addData(file.readAll());
+    }
+    key.hash = hash.result();
+    return key;
+}
+
+QString DatasetCache::cachePathFor(const QString &txtPath) {
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/datasets";
+    const QByteArray name = QCryptographicHash::hash(QFileInfo(txtPath).absoluteFilePath().toUtf8(),
+                                                     QCryptographicHash::Sha1).toHex();
+    return QDir(dir).filePath(QString::fromLatin1(name) + ".ssd");
+}
+
+bool DatasetCache::save(const SensorDataset &dataset, const SourceKey &key, const QString &cachePath) {
+    if (!key.isValid()) return false;
+    QDir().mkpath(QFileInfo(cachePath).absolutePath());
+
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write dataset cache:" << cachePath;
+        return false;
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.rawSampleSize = sizeof(RawSample);
+    header.sensorCount = quint32(dataset.sensors.size());
+    header.sourceSize = key.size;
+    header.sourceMtime = key.mtime;
+    std::memcpy(header.sourceHash, key.hash.constData(), qMin<qsizetype>(key.hash.size(), sizeof(header.sourceHash)));
+    header.rowCount = dataset.time.size();
+    header.globalReference = dataset.globalReference;
+    header.minTime = dataset.minTime;
+    header.maxTime = dataset.maxTime;
+    header.minValue = dataset.minValue;
+    header.maxValue = dataset.maxValue;
+
+    bool ok = writeBlock(file, &header, sizeof(header));
+
+    for (const Sensor &s : dataset.sensors) {
+        const QByteArray name = s.name.toUtf8();
+        SensorRecord rec = {};
+        rec.id = s.id;
+        rec.nameBytes = qint32(name.size());
+        rec.offset = s.offset;
+        rec.size = s.size();
+        rec.kA = s.kA;
+        rec.kB = s.kB;
+        rec.statsA = toRecord(s.statsA);
+        rec.statsB = toRecord(s.statsB);
+        rec.statsTime = toRecord(s.statsTime);
+        rec.monitorA = s.monitorA;
+        rec.monitorB = s.monitorB;
+        ok = ok && writeBlock(file, &rec, sizeof(rec)) && writeBlock(file, name.constData(), name.size());
+    }
+
+    ok = ok && writeBlock(file, dataset.time.constData(), dataset.time.size() * qint64(sizeof(double)));
+
+    for (const Sensor &s : dataset.sensors) {
+        ok = ok && writeColumn(file, s.rawA) && writeColumn(file, s.rawB)
+             && writeLod(file, s.lodA) && writeLod(file, s.lodB);
+    }
+    // Недочитанные куски записались бы пропусками - такой кэш хуже, чем никакого
+    ok = ok && !dataset.storageFailed();
+
+    if (!ok || !file.commit()) {
+        qWarning() << "Failed to write dataset cache:" << cachePath;
+        return false;
+    }
+    return true;
+}
+
+bool DatasetCache::load(const QString &cachePath, const SourceKey &key, SensorDataset &dataset,
+                        const ColumnStorageOptions &storage) {
+    if (!key.isValid()) return false;
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    const qint64 size = file.size();
+    const uchar *mapped = (size > 0) ? file.map(0, size) : nullptr;
+    if (!mapped) return false;
+
+    Reader reader(mapped, size);
+    SensorDataset result;
+    QVector<qint64> sizes;
+    bool ok = true;
+
+    FileHeader header;
+    ok = reader.read(header)
+         && std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+         && header.version == kVersion
+         && header.byteOrder == kByteOrderMark
+         && header.rawSampleSize == sizeof(RawSample)
+         && header.sourceSize == key.size
+         && header.sourceMtime == key.mtime
+         && key.hash.size() <= qsizetype(sizeof(header.sourceHash))
+         && std::memcmp(header.sourceHash, key.hash.constData(), key.hash.size()) == 0;
+
+    if (ok) {
+        result.globalReference = header.globalReference;
+        result.minTime = header.minTime;
+        result.maxTime = header.maxTime;
+        result.minValue = header.minValue;
+        result.maxValue = header.maxValue;
+        result.sensors.resize(header.sensorCount);
+        sizes.reserve(header.sensorCount);
+
+        for (Sensor &s : result.sensors) {
+            SensorRecord rec;
+            const uchar *name = nullptr;
+            ok = reader.read(rec) && rec.nameBytes >= 0 && (name = reader.take(rec.nameBytes)) != nullptr
+                 && rec.offset >= 0 && rec.size >= 0 && rec.offset + rec.size <= header.rowCount;
+            if (!ok) break;
+            s.id = rec.id;
+            s.name = QString::fromUtf8(reinterpret_cast<const char *>(name), rec.nameBytes);
+            s.offset = rec.offset;
+            s.kA = rec.kA;
+            s.kB = rec.kB;
+            s.statsA = fromRecord(rec.statsA);
+            s.statsB = fromRecord(rec.statsB);
+            s.statsTime = fromRecord(rec.statsTime);
+            s.monitorA = rec.monitorA;
+            s.monitorB = rec.monitorB;
+            // Колонки идут следом за осью времени
+            sizes.append(rec.size);
+        }
+    }
+
+    ok = ok && reader.readArray(result.time, header.rowCount);
+
+    if (ok) {
+        qint64 columnBytes = 0;
+        for (qint64 n : std::as_const(sizes)) columnBytes += 2 * n * qint64(sizeof(RawSample));
+        ok = ChunkStore::forColumns(columnBytes, storage, result.store);
+    }
+
+    if (ok) {
+        for (int i = 0; i < result.sensors.size() && ok; ++i) {
+            Sensor &s = result.sensors[i];
+            const qint64 n = sizes.at(i);
+            ok = reader.readColumn(s.rawA, n, result.store) && reader.readColumn(s.rawB, n, result.store)
+                 && readLod(reader, s.lodA, n) && readLod(reader, s.lodB, n);
+        }
+    }
+    ok = ok && !(result.store && result.store->hasError());
+
+    file.unmap(const_cast<uchar *>(mapped));
+    file.close();
+
+    if (!ok) {
+        qInfo() << "Dataset cache is stale or damaged, ignoring:" << cachePath;
+        return false;
+    }
+    dataset = std::move(result);
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef DATASETCACHE_H
+#define DATASETCACHE_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "sensordata.h"
+
+// Бинарный кэш разобранного набора данных.
+//
+// Формат (все блоки выровнены на 8 байт, порядок байт - родной, проверяется):
+//   FileHeader     - сигнатура, версия, ключ исходного файла, число строк/датчиков,
+//                    globalReference и диапазоны
+//   SensorRecord[] - id, offset, size, kA/kB, агрегаты каналов; за каждой - имя (UTF-8)
+//   time[]         - общая ось времени (double)
+//   на каждый датчик: rawA[], rawB[] (RawSample), затем пирамиды lodA и lodB
+//
+// Файл открывается через QFile::map, колонки копируются блоками без разбора текста.
+// Кэш действителен, пока у исходного TXT совпадают размер, mtime и хэш
+// (SHA-256 от размера и первого/последнего мегабайта).
+class DatasetCache
+{
+public:
+    struct SourceKey {
+        qint64 size = -1;
+        qint64 mtime = 0;
+        QByteArray hash;
+
+        bool isValid() const { return size >= 0 && !hash.isEmpty(); }
+    };
+
+    static SourceKey sourceKey(const QString &txtPath);
+    static QString cachePathFor(const QString &txtPath);
+
+    static bool save(const SensorDataset &dataset, const SourceKey &key, const QString &cachePath);
+    // storage: колонки копируются не в память, а в хранилище (SensorDataset::store),
+    // если так решит ChunkStore::forColumns - на диск или сжатыми
+    static bool load(const QString &cachePath, const SourceKey &key, SensorDataset &dataset,
+                     const ColumnStorageOptions &storage = ColumnStorageOptions());
+};
+
+#endif // DATASETCACHE_H
@@ -0,0 +1,175 @@
+#include "datasetloader.h"
+#include "datasetcache.h"
+#include "taskcontrol.h"
+#include "tracer.h"
+#include "txtparser.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <atomic>
+#include <numeric>
+
+namespace {
+
+// Статистика, пирамиды, калибровка и диапазоны свежего набора (после разбора или сведения)
+void prepare(SensorDataset &dataset, const DatasetLoadOptions &options, bool buildLod) {
+    {
+        TraceScope model("buildModel");
+        dataset.computeStats();
+        dataset.rolling.window = options.calibrationWindow;
+        if (dataset.rolling.window > 0) dataset.computeDrift();
+        if (buildLod) dataset.buildLod();
+        if (options.forDisplay) dataset.buildAggregates();
+        model.setRows(dataset.time.size());
+    }
+    {
+        TraceScope calibrate("calibrate");
+        dataset.anomaly = options.anomaly;
+        dataset.preCalculateCalibration();
+    }
+    {
+        TraceScope ranges("ranges");
+        dataset.calculateRanges();
+    }
+}
+
+} // namespace
+
+bool DatasetLoader::load(const QString &txtPath, SensorDataset &dataset, TaskControl *control,
+                         const DatasetLoadOptions &options) {
+    QElapsedTimer timer;
+    timer.start();
+    TraceScope trace("load", "load");
+
+    // 0. Бинарный кэш: если исходник не менялся - никакого разбора.
+    // Дописываемый файл меняется постоянно, для него кэш не нужен.
+    const bool useCache = options.useCache && options.parsedBytes == nullptr;
+    const DatasetCache::SourceKey key = useCache ? DatasetCache::sourceKey(txtPath) : DatasetCache::SourceKey();
+    const QString cachePath = useCache ? DatasetCache::cachePathFor(txtPath) : QString();
+    bool restored = false;
+    if (useCache) {
+        TraceScope restore("cacheRestore");
+        restored = DatasetCache::load(cachePath, key, dataset, options.storage);
+        restore.setRows(dataset.time.size());
+    }
+    if (restored) {
+        // Калибровка по сохраненным агрегатам - O(датчиков), суммы по окнам - один проход.
+        // Корзин скользящей калибровки в кэше нет - это еще один проход по отсчетам
+        {
+            TraceScope calibrate("calibrate");
+            dataset.rolling.window = options.calibrationWindow;
+            if (dataset.rolling.window > 0) dataset.computeDrift();
+            dataset.anomaly = options.anomaly;
+            dataset.preCalculateCalibration();
+        }
+        if (options.forDisplay) {
+            TraceScope model("buildModel");
+            dataset.buildAggregates();
+        }
+        if (dataset.storageFailed()) {
+            qWarning() << "Failed to read column storage:" << cachePath;
+            return false;
+        }
+        trace.setRows(dataset.time.size());
+        qInfo() << "Step 1: Restored from dataset cache in" << timer.elapsed() << "ms:" << cachePath;
+        if (dataset.store) qInfo().noquote() << "Columns:" << dataset.store->describe();
+        return true;
+    }
+
+    // 1. Прямой разбор TXT сразу в колонки, без временного JSON
+    qInfo() << "Step 1: Parsing TXT..." << txtPath;
+
+    if (!TxtParser::parseFile(txtPath, dataset, options.threadCount, control, options.parsedBytes,
+                              options.storage)) {
+        if (control && control->isCanceled()) qInfo() << "Import canceled:" << txtPath;
+        else qWarning() << "Failed to parse TXT:" << txtPath;
+        return false;
+    }
+    const qint64 parseMs = timer.elapsed();
+
+    // 2. Один проход по отсчетам, дальше калибровка и диапазоны по агрегатам.
+    // Пирамиды пишутся в кэш, поэтому с кэшем строятся всегда.
+    prepare(dataset, options, options.forDisplay || useCache);
+    if (dataset.storageFailed()) {
+        qWarning() << "Failed to read column storage:" << txtPath;
+        return false;
+    }
+    trace.setRows(dataset.time.size());
+    qInfo() << "Step 2: Data loaded & Math calculated." << "parse:" << parseMs << "ms, total:" << timer.elapsed() << "ms";
+    if (dataset.store) qInfo().noquote() << "Columns:" << dataset.store->describe();
+
+    // 3. Кэш для мгновенного повторного открытия
+    if (useCache) {
+        qInfo() << "Step 3: Writing dataset cache:" << cachePath;
+        TraceScope save("cacheWrite");
+        DatasetCache::save(dataset, key, cachePath);
+    }
+    return true;
+}
+
+bool DatasetLoader::loadSession(const QStringList &txtPaths, SessionMode mode, SensorDataset &dataset,
+                                TaskControl *control, const DatasetLoadOptions &options) {
+    QElapsedTimer timer;
+    timer.start();
+    TraceScope trace("loadSession", "load");
+    const int n = int(txtPaths.size());
+    if (n == 0) return false;
+
+    // Прогоны - без скользящей калибровки и агрегатов графика: это считается по сессии.
+    // Статистику и калибровку по ней прогон считает сам (дешево, по агрегатам), а с
+    // кэшем еще строит пирамиды и пишет .ssd: повторная сборка сессии идет из кэшей
+    // прогонов без разбора TXT
+    DatasetLoadOptions runOptions = options;
+    runOptions.forDisplay = false;
+    runOptions.calibrationWindow = 0;
+    runOptions.parsedBytes = nullptr;
+    const int cores = (options.threadCount > 0) ? options.threadCount : qMax(1, QThread::idealThreadCount());
+    runOptions.threadCount = qMax(1, cores / n);
+
+    // У каждого прогона свой TaskControl под общим (разбор сам ставит total): прогресс
+    // складывается в control, отмена control видна прогонам сразу. blockingMap из
+    // задачи пула отдает свой поток на время ожидания
+    QVector<SensorDataset> runs(n);
+    SensorDataset *runData = runs.data();
+    std::atomic<bool> failed{false};
+    QVector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+
+    QtConcurrent::blockingMap(order, [&](int r) {
+        TaskControl runControl(control);
+        if (!failed && !load(txtPaths[r], runData[r], &runControl, runOptions)) failed = true;
+    });
+    if (control && control->isCanceled()) return false;
+    if (failed) {
+        qWarning() << "Session not loaded: one of the runs failed";
+        return false;
+    }
+    const qint64 loadMs = timer.elapsed();
+
+    QStringList labels;
+    for (const QString &path : txtPaths) labels << QFileInfo(path).completeBaseName();
+    {
+        TraceScope merge("mergeRuns");
+        if (!SessionMerger::merge(runs, labels, mode, options.storage, dataset)) {
+            qWarning() << "Session not loaded: failed to create column storage";
+            return false;
+        }
+        merge.setRows(dataset.time.size());
+    }
+    runs.clear(); // исходные колонки больше не нужны
+
+    prepare(dataset, options, options.forDisplay);
+    if (dataset.storageFailed()) {
+        qWarning() << "Session not loaded: failed to read column storage";
+        return false;
+    }
+    trace.setRows(dataset.time.size());
+    qInfo() << "Session:" << n << "runs," << dataset.time.size() << "rows," << dataset.sensors.size()
+            << "sensors; load:" << loadMs << "ms, total:" << timer.elapsed() << "ms";
+    if (dataset.store) qInfo().noquote() << "Columns:" << dataset.store->describe();
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef DATASETLOADER_H
+#define DATASETLOADER_H
+
+#include <QString>
+#include <QStringList>
+
+#include "sensordata.h"
+#include "sessionmerger.h"
+
+class TaskControl;
+
+// Как загружать набор (вне класса - см. CsvExportOptions)
+struct DatasetLoadOptions {
+    bool useCache = true;          // бинарный кэш DatasetCache
+    bool forDisplay = true;        // пирамиды и префиксные суммы: нужны графику, не экспорту
+    int threadCount = 0;           // потоков на разбор одного файла, 0 - по числу ядер
+    qint64 *parsedBytes = nullptr; // файл дописывается: только целые строки, без кэша
+    ColumnStorageOptions storage;  // лимит памяти (колонки на диске) и сжатие колонок
+    double calibrationWindow = 0;  // с; > 0 - скользящая калибровка (RollingCalibration)
+    AnomalyOptions anomaly;        // пороги детекторов и исключение датчиков из эталона
+};
+
+// Весь путь от results.txt до готового набора: кэш или разбор, статистика,
+// калибровка, диапазоны. Без GUI - общий для приложения и SolarSensorsCli,
+// безопасно вызывать из рабочего потока.
+class DatasetLoader
+{
+public:
+    static bool load(const QString &txtPath, SensorDataset &dataset, TaskControl *control = nullptr,
+                     const DatasetLoadOptions &options = DatasetLoadOptions());
+
+    // Сессия из нескольких прогонов: файлы грузятся одновременно (ядра делятся между
+    // ними, кэш - как у load), сводятся SessionMerger, а статистика и калибровка
+    // считаются уже по всей сессии из колонок в памяти - файлы второй раз не читаются.
+    static bool loadSession(const QStringList &txtPaths, SessionMode mode, SensorDataset &dataset,
+                            TaskControl *control = nullptr, const DatasetLoadOptions &options = DatasetLoadOptions());
+};
+
+#endif // DATASETLOADER_H
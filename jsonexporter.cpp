@@ -0,0 +1,361 @@
+#include "jsonexporter.h"
+#include "taskcontrol.h"
+#include "tracer.h"
+
+#include <QFile>
+#include <QDateTime>
+#include <QThread>
+#include <QDebug>
+#include <QtMath>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace {
+
+// Блок точек одного датчика [from, to) (отсчеты или узлы сетки), отформатированный в text
+struct Piece {
+    int sensor;
+    qsizetype from;
+    qsizetype to;
+    QByteArray text;
+};
+
+// Отступы и разделители для двух режимов
+struct Style {
+    bool indented;
+
+    void newline(QByteArray &out, int depth) const {
+        if (!indented) return;
+        static const char spaces[] = "                        ";
+        out.append('\n');
+        out.append(spaces, depth * 4);
+    }
+    void key(QByteArray &out, int depth, const char *name) const {
+        newline(out, depth);
+        out.append('"').append(name).append(indented ? "\": " : "\":");
+    }
+};
+
+// Фиксированная точность: t, corr, проценты ошибки
+void appendFixed(QByteArray &out, double v, int precision) {
+    if (!std::isfinite(v)) { out.append("null"); return; } // как QJsonDocument
+    char buf[128];
+    std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::fixed, precision);
+    if (r.ec != std::errc()) r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, r.ptr - buf);
+}
+
+// Кратчайшее точное представление: сырые значения и коэффициенты
+template <typename T>
+void appendShortest(QByteArray &out, T v) {
+    if (!std::isfinite(v)) { out.append("null"); return; }
+    char buf[64];
+    const std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, r.ptr - buf);
+}
+
+void appendString(QByteArray &out, const QString &s) {
+    static const char hex[] = "0123456789abcdef";
+    out.append('"');
+    for (const char c : s.toUtf8()) {
+        switch (c) {
+        case '"': out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (uchar(c) < 0x20) out.append("\\u00").append(hex[uchar(c) >> 4]).append(hex[uchar(c) & 0xF]);
+            else out.append(c);
+        }
+    }
+    out.append('"');
+}
+
+// Каждая точка пишется с ведущим разделителем ","; у первой точки датчика
+// запятую срезает писатель (пропуски не дают заранее знать, какая точка первая)
+void formatPiece(const SensorDataset &dataset, const Style &style, Piece &piece) {
+    const Sensor &s = dataset.sensors.at(piece.sensor);
+    QByteArray &out = piece.text;
+    out.reserve((piece.to - piece.from) * (style.indented ? 170 : 80));
+
+    SampleColumn::Cursor rawA(s.rawA), rawB(s.rawB);
+    for (qsizetype i = piece.from; i < piece.to; ++i) {
+        const RawSample a = rawA[i];
+        if (isGap(a)) continue;
+        const RawSample b = rawB[i];
+        out.append(',');
+        style.newline(out, 4);
+        out.append('{');
+        style.key(out, 5, "corr_A"); appendFixed(out, a * dataset.coefficient(s, 0, i), 2); out.append(',');
+        style.key(out, 5, "corr_B"); appendFixed(out, b * dataset.coefficient(s, 1, i), 2); out.append(',');
+        style.key(out, 5, "raw_A"); appendShortest(out, a); out.append(',');
+        style.key(out, 5, "raw_B"); appendShortest(out, b); out.append(',');
+        style.key(out, 5, "t"); appendFixed(out, dataset.timeAt(s, i), 3);
+        style.newline(out, 4);
+        out.append('}');
+    }
+}
+
+// То же на сетке: точка - узел, значения - средние отсчетов датчика в узле
+void formatGridPiece(const SensorDataset &dataset, const TimeGrid &grid, const Style &style, Piece &piece) {
+    const Sensor &s = dataset.sensors.at(piece.sensor);
+    QByteArray &out = piece.text;
+    out.reserve((piece.to - piece.from) * (style.indented ? 170 : 80));
+
+    SampleColumn::Cursor rawA(s.rawA), rawB(s.rawB);
+    GridSample v;
+    for (qsizetype e = piece.from; e < piece.to; ++e) {
+        if (!dataset.gridSample(s, grid.rows[e], grid.rows[e + 1], rawA, rawB, v)) continue;
+        out.append(',');
+        style.newline(out, 4);
+        out.append('{');
+        style.key(out, 5, "corr_A"); appendFixed(out, v.corrA, 2); out.append(',');
+        style.key(out, 5, "corr_B"); appendFixed(out, v.corrB, 2); out.append(',');
+        style.key(out, 5, "raw_A"); appendShortest(out, v.rawA); out.append(',');
+        style.key(out, 5, "raw_B"); appendShortest(out, v.rawB); out.append(',');
+        style.key(out, 5, "t"); appendFixed(out, grid.times[e], 3);
+        style.newline(out, 4);
+        out.append('}');
+    }
+}
+
+// Коэффициенты скользящей калибровки в центрах корзин: [{coeff_A, coeff_B, t}, ...]
+void appendTimeline(QByteArray &out, const Style &style, const RollingCalibration &rolling, const Sensor &s) {
+    const qsizetype n = std::max(s.driftA.k.size(), s.driftB.k.size());
+    out.append('[');
+    for (qsizetype j = 0; j < n; ++j) {
+        if (j > 0) out.append(',');
+        style.newline(out, 5);
+        out.append('{');
+        const double t = rolling.centerTime(j);
+        style.key(out, 6, "coeff_A"); appendShortest(out, rolling.interpolate(s.driftA.k, t, s.kA)); out.append(',');
+        style.key(out, 6, "coeff_B"); appendShortest(out, rolling.interpolate(s.driftB.k, t, s.kB)); out.append(',');
+        style.key(out, 6, "t"); appendFixed(out, t, 3);
+        style.newline(out, 5);
+        out.append('}');
+    }
+    if (n > 0) style.newline(out, 4);
+    out.append(']');
+}
+
+// Матрица корреляций: имена каналов и строки матрицы (строка - на своей строке файла)
+void appendCorrelation(QByteArray &out, const Style &style, const CorrelationMatrix &m) {
+    out.append('{');
+    style.key(out, 3, "channels");
+    out.append('[');
+    for (qsizetype i = 0; i < m.size(); ++i) {
+        if (i > 0) out.append(',');
+        appendString(out, m.channels[i]);
+    }
+    out.append("],");
+    style.key(out, 3, "matrix");
+    out.append('[');
+    for (qsizetype i = 0; i < m.size(); ++i) {
+        if (i > 0) out.append(',');
+        style.newline(out, 4);
+        out.append('[');
+        for (qsizetype j = 0; j < m.size(); ++j) {
+            if (j > 0) out.append(',');
+            appendFixed(out, m.at(i, j), 4);
+        }
+        out.append(']');
+    }
+    if (m.size() > 0) style.newline(out, 3);
+    out.append(']');
+    style.newline(out, 2);
+    out.append('}');
+}
+
+void sensorHead(QByteArray &out, const Style &style, const RollingCalibration &rolling, const Sensor &s,
+                bool first) {
+    if (!first) out.append(',');
+    style.newline(out, 2);
+    out.append('{');
+    style.key(out, 3, "calibration");
+    out.append('{');
+    style.key(out, 4, "coeff_A"); appendShortest(out, s.kA); out.append(',');
+    style.key(out, 4, "coeff_B"); appendShortest(out, s.kB); out.append(',');
+    style.key(out, 4, "error_A_percent"); appendFixed(out, (s.kA - 1.0) * 100.0, 2); out.append(',');
+    style.key(out, 4, "error_B_percent"); appendFixed(out, (s.kB - 1.0) * 100.0, 2);
+    if (rolling.isActive()) {
+        out.append(',');
+        style.key(out, 4, "timeline"); appendTimeline(out, style, rolling, s);
+    }
+    style.newline(out, 3);
+    out.append("},");
+    style.key(out, 3, "data");
+    out.append('[');
+}
+
+void sensorTail(QByteArray &out, const Style &style, const Sensor &s, bool hasPoints) {
+    if (hasPoints) style.newline(out, 3);
+    out.append("],");
+    style.key(out, 3, "id"); out.append(QByteArray::number(s.id)); out.append(',');
+    style.key(out, 3, "name"); appendString(out, s.name);
+    style.newline(out, 2);
+    out.append('}');
+}
+
+} // namespace
+
+bool JsonExporter::write(const SensorDataset &dataset, const QString &path, TaskControl *control, Format format,
+                         double step, const CorrelationMatrix *correlation) {
+    TraceScope trace(format == Format::Indented ? "exportJson" : "exportJsonCompact", "export");
+    const QVector<Sensor> &sensors = dataset.sensors;
+    const Style style{format == Format::Indented};
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to save JSON:" << path;
+        return false;
+    }
+
+    // С шагом - одна сетка на весь набор, датчику достаются узлы, задевающие его строки
+    TimeGrid grid;
+    const bool resample = step > 0.0;
+    if (resample) dataset.buildGrid(step, 0, dataset.time.size(), grid);
+
+    // Раскладка на блоки: и много мелких датчиков, и один огромный грузят все потоки
+    QVector<Piece> pieces;
+    qint64 totalPoints = 0;
+    for (int si = 0; si < sensors.size(); ++si) {
+        const Sensor &s = sensors.at(si);
+        qsizetype first = 0, last = s.size();
+        if (resample) {
+            const qsizetype *rows = grid.rows.constData();
+            first = std::upper_bound(rows + 1, rows + grid.size() + 1, s.offset) - (rows + 1);
+            last = std::lower_bound(rows, rows + grid.size(), s.offset + s.size()) - rows;
+        }
+        totalPoints += qMax<qsizetype>(0, last - first);
+        for (qsizetype from = first; from < last; from += kBlockRows)
+            pieces.append({si, from, qMin(last, from + kBlockRows), QByteArray()});
+    }
+    if (control) control->setTotal(totalPoints);
+
+    const double avgDevPercent = dataset.avgDeviation * 100.0;
+
+    QByteArray out;
+    out.reserve(kFlushBytes + kFlushBytes / 4);
+    bool ok = true;
+    qint64 written = 0;
+    auto flush = [&](bool force) {
+        if (!ok || (!force && out.size() < kFlushBytes)) return;
+        ok = file.write(out) == out.size();
+        written += out.size();
+        out.clear();
+    };
+
+    // Ключи по алфавиту, как в QJsonObject: meta_info, sensors, statistics
+    out.append('{');
+    style.key(out, 1, "meta_info");
+    out.append('{');
+    style.key(out, 2, "app_name"); appendString(out, QStringLiteral("SolarSensors Analytics")); out.append(',');
+    style.key(out, 2, "exported_at"); appendString(out, QDateTime::currentDateTime().toString(Qt::ISODate));
+    style.newline(out, 1);
+    out.append("},");
+    style.key(out, 1, "sensors");
+    out.append('[');
+
+    // Партиями по несколько блоков на поток: в памяти держится только партия
+    const qsizetype batchSize = qMax(1, QThread::idealThreadCount()) * 2;
+    int current = -1;
+    bool hasPoints = false;
+    // Закрывает текущий датчик и открывает следующие вплоть до target
+    // (пустые датчики блоков не дают, но в документе должны остаться)
+    auto advanceTo = [&](int target) {
+        while (current < target) {
+            if (current >= 0) sensorTail(out, style, sensors.at(current), hasPoints);
+            ++current;
+            sensorHead(out, style, dataset.rolling, sensors.at(current), current == 0);
+            hasPoints = false;
+        }
+    };
+    for (qsizetype b = 0; b < pieces.size() && ok; b += batchSize) {
+        if (control && control->isCanceled()) break;
+
+        QVector<Piece> batch = pieces.mid(b, batchSize);
+        QtConcurrent::blockingMap(batch, [&](Piece &p) {
+            if (resample) formatGridPiece(dataset, grid, style, p);
+            else formatPiece(dataset, style, p);
+        });
+
+        for (const Piece &p : batch) {
+            advanceTo(p.sensor);
+            if (!p.text.isEmpty()) {
+                // Ведущая запятая первой точки датчика не нужна
+                out.append(hasPoints ? p.text : p.text.sliced(1));
+                hasPoints = true;
+            }
+            if (control) control->addDone(p.to - p.from);
+            flush(false);
+        }
+    }
+
+    if (control && control->isCanceled()) {
+        file.close();
+        file.remove();
+        return false;
+    }
+
+    advanceTo(int(sensors.size()) - 1);
+    if (current >= 0) {
+        sensorTail(out, style, sensors.at(current), hasPoints);
+        style.newline(out, 1);
+    }
+    out.append("],");
+
+    style.key(out, 1, "statistics");
+    out.append('{');
+    style.key(out, 2, "average_system_deviation_percent"); appendFixed(out, avgDevPercent, 2); out.append(',');
+    if (correlation && !correlation->isEmpty()) {
+        style.key(out, 2, "correlation"); appendCorrelation(out, style, *correlation); out.append(',');
+    }
+    style.key(out, 2, "global_reference_value"); appendShortest(out, dataset.globalReference); out.append(',');
+    if (dataset.rolling.isActive()) {
+        // Опорные значения скользящей калибровки по корзинам
+        const RollingCalibration &rolling = dataset.rolling;
+        style.key(out, 2, "rolling_calibration");
+        out.append('{');
+        style.key(out, 3, "reference");
+        out.append('[');
+        for (qsizetype j = 0; j < rolling.reference.size(); ++j) {
+            if (j > 0) out.append(',');
+            style.newline(out, 4);
+            out.append('{');
+            style.key(out, 5, "t"); appendFixed(out, rolling.centerTime(j), 3); out.append(',');
+            style.key(out, 5, "value"); appendShortest(out, rolling.reference[j]);
+            style.newline(out, 4);
+            out.append('}');
+        }
+        if (!rolling.reference.isEmpty()) style.newline(out, 3);
+        out.append("],");
+        style.key(out, 3, "step_seconds"); appendShortest(out, rolling.step()); out.append(',');
+        style.key(out, 3, "window_seconds"); appendShortest(out, rolling.window);
+        style.newline(out, 2);
+        out.append("},");
+    }
+    style.key(out, 2, "total_sensors_count"); out.append(QByteArray::number(sensors.size()));
+    style.newline(out, 1);
+    out.append('}');
+    style.newline(out, 0);
+    out.append('}');
+    if (style.indented) out.append('\n');
+    flush(true);
+
+    ok = ok && !dataset.storageFailed();
+    if (!ok) {
+        file.close();
+        file.remove();
+        qWarning() << "Failed to save JSON:" << path;
+        return false;
+    }
+    file.close();
+    trace.setBytes(written);
+    trace.setRows(totalPoints);
+    qInfo() << "Exported JSON to:" << path;
+    return true;
+}
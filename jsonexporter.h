@@ -0,0 +1,30 @@
+#ifndef JSONEXPORTER_H
+#define JSONEXPORTER_H
+
+#include <QString>
+
+#include "sensordata.h"
+#include "correlation.h"
+
+class TaskControl;
+
+// Экспорт набора данных в JSON (meta_info, statistics, sensors[].calibration, sensors[].data).
+// Документ не собирается в памяти: точки форматируются блоками (параллельно)
+// и сразу пишутся в файл. Порядок ключей тот же, что давал QJsonDocument.
+class JsonExporter
+{
+public:
+    enum class Format { Indented, Compact };
+
+    // step > 0 - точки на сетке с этим шагом (с): средние отсчетов узла, t - начало узла.
+    // correlation (может быть nullptr) - в statistics.correlation: { channels, matrix }
+    static bool write(const SensorDataset &dataset, const QString &path, TaskControl *control = nullptr,
+                      Format format = Format::Indented, double step = 0.0,
+                      const CorrelationMatrix *correlation = nullptr);
+
+private:
+    static constexpr qsizetype kBlockRows = 32768;   // точек в одном блоке форматирования
+    static constexpr qsizetype kFlushBytes = 1 << 20; // порог сброса буфера в файл
+};
+
+#endif // JSONEXPORTER_H
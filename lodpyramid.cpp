@@ -0,0 +1,254 @@
+#include "lodpyramid.h"
+
+#include <algorithm>
+
+namespace {
+
+inline void pushIndex(QVector<qsizetype> &indices, qsizetype index) {
+    if (indices.isEmpty() || indices.last() < index) indices.append(index);
+}
+
+// min и max корзины в порядке следования
+inline void pushBucket(QVector<qsizetype> &indices, const LodPyramid::Bucket &b) {
+    if (b.minIndex == LodPyramid::kNoIndex) return;
+    const qsizetype lo = std::min(b.minIndex, b.maxIndex);
+    const qsizetype hi = std::max(b.minIndex, b.maxIndex);
+    pushIndex(indices, lo);
+    pushIndex(indices, hi);
+}
+
+// Значения min и max корзины: нужны только при сборке пирамиды
+struct Extremes {
+    RawSample min = 0;
+    RawSample max = 0;
+};
+
+// Дополняет корзину отсчетами [from, to) непрерывного куска, data[0] - отсчет first
+void accumulate(LodPyramid::Bucket &b, Extremes &v, const RawSample *data, qsizetype first, qsizetype from,
+                qsizetype to) {
+    for (qsizetype i = from; i < to; ++i) {
+        const RawSample x = data[i - first];
+        if (isGap(x)) continue;
+        if (b.minIndex == LodPyramid::kNoIndex) {
+            b.minIndex = b.maxIndex = quint32(i);
+            v.min = v.max = x;
+            continue;
+        }
+        if (x < v.min) {
+            b.minIndex = quint32(i);
+            v.min = x;
+        }
+        if (x > v.max) {
+            b.maxIndex = quint32(i);
+            v.max = x;
+        }
+    }
+}
+
+// Корзины базового уровня с firstBucket по отсчетам до count: один проход по
+// непрерывным кускам колонки (корзина может попасть на стык кусков).
+// values[b - firstBucket] - значения корзины b
+void scanBase(const SampleColumn &data, qsizetype firstBucket, qsizetype count, QVector<LodPyramid::Bucket> &base,
+              QVector<Extremes> &values) {
+    const qsizetype size = LodPyramid::kBaseBucket;
+    for (qsizetype b = firstBucket; b < base.size(); ++b) base[b] = LodPyramid::Bucket();
+    data.forEachSpan(firstBucket * size, count, [&](const RawSample *p, qsizetype first, qsizetype n) {
+        for (qsizetype from = first; from < first + n;) {
+            const qsizetype b = from / size;
+            const qsizetype to = std::min((b + 1) * size, first + n);
+            accumulate(base[b], values[b - firstBucket], p, first, from, to);
+            from = to;
+        }
+    });
+}
+
+// То же, что LodPyramid::merge, но по сохраненным значениям корзин
+LodPyramid::Bucket mergeValues(const LodPyramid::Bucket &a, const Extremes &va, const LodPyramid::Bucket &b,
+                               const Extremes &vb, Extremes &out) {
+    if (a.minIndex == LodPyramid::kNoIndex) {
+        out = vb;
+        return b;
+    }
+    if (b.minIndex == LodPyramid::kNoIndex) {
+        out = va;
+        return a;
+    }
+    LodPyramid::Bucket r;
+    const bool minB = vb.min < va.min;
+    const bool maxB = vb.max > va.max;
+    r.minIndex = minB ? b.minIndex : a.minIndex;
+    r.maxIndex = maxB ? b.maxIndex : a.maxIndex;
+    out.min = minB ? vb.min : va.min;
+    out.max = maxB ? vb.max : va.max;
+    return r;
+}
+
+} // namespace
+
+LodPyramid::Bucket LodPyramid::scan(const SampleColumn &data, qsizetype from, qsizetype to) {
+    Bucket b;
+    Extremes v;
+    data.forEachSpan(from, to, [&](const RawSample *p, qsizetype first, qsizetype count) {
+        accumulate(b, v, p, first, first, first + count);
+    });
+    return b;
+}
+
+LodPyramid::Bucket LodPyramid::merge(const SampleColumn &data, const Bucket &a, const Bucket &b) {
+    if (a.minIndex == kNoIndex) return b;
+    if (b.minIndex == kNoIndex) return a;
+    // При равенстве остается более ранний отсчет (a идет раньше b)
+    Bucket r;
+    r.minIndex = (data[b.minIndex] < data[a.minIndex]) ? b.minIndex : a.minIndex;
+    r.maxIndex = (data[b.maxIndex] > data[a.maxIndex]) ? b.maxIndex : a.maxIndex;
+    return r;
+}
+
+void LodPyramid::clear() {
+    m_levels.clear();
+}
+
+void LodPyramid::build(const SampleColumn &data, qsizetype count) {
+    m_levels.clear();
+    if (count <= kBaseBucket) return;
+
+    QVector<Bucket> level((count + kBaseBucket - 1) / kBaseBucket);
+    QVector<Extremes> values(level.size());
+    scanBase(data, 0, count, level, values);
+    m_levels.append(level);
+
+    // Каждый следующий уровень - попарное слияние предыдущего. Сравниваются
+    // значения корзин, а не отсчеты колонки: к диску за ними ходить не нужно
+    while (level.size() > 1) {
+        QVector<Bucket> next((level.size() + 1) / 2);
+        QVector<Extremes> nextValues(next.size());
+        for (qsizetype i = 0; i < next.size(); ++i) {
+            const qsizetype l = 2 * i;
+            if (l + 1 < level.size()) {
+                next[i] = mergeValues(level[l], values[l], level[l + 1], values[l + 1], nextValues[i]);
+            } else {
+                next[i] = level[l];
+                nextValues[i] = values[l];
+            }
+        }
+        m_levels.append(next);
+        level = next;
+        values = nextValues;
+    }
+}
+
+void LodPyramid::extend(const SampleColumn &data, qsizetype oldCount, qsizetype count) {
+    if (m_levels.isEmpty() || oldCount <= kBaseBucket) {
+        build(data, count);
+        return;
+    }
+
+    // Последняя корзина могла быть неполной - пересчитываем с нее
+    qsizetype dirty = oldCount / kBaseBucket;
+    QVector<Bucket> &base = m_levels[0];
+    base.resize((count + kBaseBucket - 1) / kBaseBucket);
+    QVector<Extremes> values(base.size() - dirty);
+    scanBase(data, dirty, count, base, values);
+
+    // Выше по пирамиде грязная зона сужается вдвое на уровень
+    for (qsizetype l = 1; m_levels[l - 1].size() > 1; ++l) {
+        if (l == m_levels.size()) m_levels.append(QVector<Bucket>());
+        const QVector<Bucket> &prev = m_levels[l - 1];
+        QVector<Bucket> &level = m_levels[l];
+        dirty /= 2;
+        level.resize((prev.size() + 1) / 2);
+        for (qsizetype i = dirty; i < level.size(); ++i) {
+            const qsizetype p = 2 * i;
+            level[i] = (p + 1 < prev.size()) ? merge(data, prev[p], prev[p + 1]) : prev[p];
+        }
+    }
+}
+
+LodPyramid::Bucket LodPyramid::range(const SampleColumn &data, qsizetype from, qsizetype to) const {
+    from = std::max<qsizetype>(from, 0);
+    const qsizetype baseCount = m_levels.isEmpty() ? 0 : m_levels.first().size();
+    const qsizetype firstBucket = std::min((from + kBaseBucket - 1) / kBaseBucket, baseCount);
+    const qsizetype lastBucket = std::min(to / kBaseBucket, baseCount);
+    if (firstBucket >= lastBucket) return scan(data, from, to);
+
+    Bucket left = scan(data, from, firstBucket * kBaseBucket);
+    Bucket right = scan(data, lastBucket * kBaseBucket, to);
+
+    // Снизу вверх, как в дереве отрезков: нечетные края забираем на текущем уровне
+    qsizetype lo = firstBucket;
+    qsizetype hi = lastBucket;
+    for (qsizetype l = 0; lo < hi; ++l, lo /= 2, hi /= 2) {
+        const QVector<Bucket> &level = m_levels.at(l);
+        if (lo & 1) left = merge(data, left, level.at(lo++));
+        if (hi & 1) right = merge(data, level.at(--hi), right);
+    }
+    return merge(data, left, right);
+}
+
+void LodPyramid::decimate(const SampleColumn &data, qsizetype from, qsizetype to, int maxBuckets,
+                          QVector<qsizetype> &indices) const {
+    indices.clear();
+    from = std::max<qsizetype>(from, 0);
+    if (to <= from) return;
+    maxBuckets = std::max(maxBuckets, 1);
+    const qsizetype n = to - from;
+
+    if (n <= 2 * qsizetype(maxBuckets)) {
+        indices.reserve(n);
+        data.forEachSpan(from, to, [&indices](const RawSample *p, qsizetype first, qsizetype count) {
+            for (qsizetype k = 0; k < count; ++k)
+                if (!isGap(p[k])) indices.append(first + k);
+        });
+        return;
+    }
+
+    indices.reserve(2 * maxBuckets + 6);
+
+    // Крайние точки интервала, чтобы линия доходила до краев окна
+    SampleColumn::Cursor cursor(data);
+    qsizetype first = from;
+    while (first < to && isGap(cursor[first])) ++first;
+    qsizetype last = to - 1;
+    while (last > first && isGap(cursor[last])) --last;
+    if (first >= to) return;
+    pushIndex(indices, first);
+
+    // Самый крупный уровень, корзины которого не больше корзины вывода
+    const qsizetype perBucket = n / maxBuckets;
+    int level = -1;
+    for (int l = 0; l < m_levels.size() && (kBaseBucket << l) <= perBucket; ++l) level = l;
+
+    if (level < 0) {
+        // Корзины вывода мельче базовых - считаем прямо по отсчетам (n <= 64 * maxBuckets)
+        for (qsizetype b = 0; b < maxBuckets; ++b)
+            pushBucket(indices, scan(data, from + n * b / maxBuckets, from + n * (b + 1) / maxBuckets));
+        pushIndex(indices, last);
+        return;
+    }
+
+    const QVector<Bucket> &buckets = m_levels.at(level);
+    const qsizetype size = kBaseBucket << level;
+    const qsizetype firstFull = (from + size - 1) / size;
+    const qsizetype lastFull = std::min<qsizetype>(to / size, buckets.size());
+
+    if (firstFull >= lastFull) {
+        pushBucket(indices, scan(data, from, to));
+        pushIndex(indices, last);
+        return;
+    }
+
+    // Неполные корзины по краям - прямым проходом (меньше size отсчетов каждая)
+    pushBucket(indices, scan(data, from, firstFull * size));
+
+    const qsizetype fullCount = lastFull - firstFull;
+    const qsizetype group = (fullCount + maxBuckets - 1) / maxBuckets;
+    for (qsizetype g = firstFull; g < lastFull; g += group) {
+        Bucket b = buckets[g];
+        const qsizetype groupEnd = std::min(g + group, lastFull);
+        for (qsizetype j = g + 1; j < groupEnd; ++j) b = merge(data, b, buckets[j]);
+        pushBucket(indices, b);
+    }
+
+    pushBucket(indices, scan(data, lastFull * size, to));
+    pushIndex(indices, last);
+}
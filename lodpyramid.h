@@ -0,0 +1,52 @@
+#ifndef LODPYRAMID_H
+#define LODPYRAMID_H
+
+#include <QVector>
+
+#include "samplecolumn.h"
+
+// Многоуровневая пирамида min/max одного канала для отрисовки.
+// Уровень L делит отсчеты на корзины по kBaseBucket << L и хранит для каждой
+// индексы минимума и максимума (сами значения берутся из колонки), поэтому
+// пирамида занимает ~0.25 байта на отсчет. decimate() выдает для интервала
+// не больше ~2 точек на корзину вывода, при этом пики и провалы сохраняются точно.
+// Сборка идет одним проходом по колонке, поэтому колонка может лежать на диске.
+class LodPyramid
+{
+public:
+    static constexpr qsizetype kBaseBucket = 64;
+    static constexpr quint32 kNoIndex = 0xFFFFFFFFu;
+
+    struct Bucket {
+        quint32 minIndex = kNoIndex;
+        quint32 maxIndex = kNoIndex;
+    };
+
+    void build(const SampleColumn &data, qsizetype count);
+    // Колонка выросла с oldCount до count: пересчитываются только хвостовые корзины
+    void extend(const SampleColumn &data, qsizetype oldCount, qsizetype count);
+    void clear();
+    bool isEmpty() const { return m_levels.isEmpty(); }
+
+    // Для сохранения в кэш набора данных
+    const QVector<QVector<Bucket>> &levels() const { return m_levels; }
+    void setLevels(const QVector<QVector<Bucket>> &levels) { m_levels = levels; }
+
+    // Индексы отсчетов из [from, to) по возрастанию: первая и последняя точка
+    // интервала плюс min и max каждой из ~maxBuckets корзин. Пропуски не выдаются.
+    // Если отсчетов немного (<= 2 * maxBuckets) - выдаются все.
+    void decimate(const SampleColumn &data, qsizetype from, qsizetype to, int maxBuckets,
+                  QVector<qsizetype> &indices) const;
+
+    // Индексы min и max на [from, to) за O(log n): края - прямым проходом,
+    // середина - наибольшими целыми корзинами пирамиды
+    Bucket range(const SampleColumn &data, qsizetype from, qsizetype to) const;
+
+private:
+    static Bucket scan(const SampleColumn &data, qsizetype from, qsizetype to);
+    static Bucket merge(const SampleColumn &data, const Bucket &a, const Bucket &b);
+
+    QVector<QVector<Bucket>> m_levels;
+};
+
+#endif // LODPYRAMID_H
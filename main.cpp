@@ -1,17 +1,21 @@
 #include <QApplication>
 #include <QQuickWidget>
 #include <QQmlContext>
+#include <QQmlEngine>
 #include <QVBoxLayout>
 #include <QWidget>
 #include <QDir>
 #include <QDebug>
-#include <QElapsedTimer>
 #include <QQuickStyle>
+#include <QQuickWindow>
 #include <QFile>
 
 #include "sensormodel.h"
+#include "sensorplot.h"
+#include "tracer.h"
 
 int main(int argc, char **argv) {
+    const qint64 startUs = Tracer::nowUs();
     QQuickStyle::setStyle("Basic");
 
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
@@ -19,10 +23,12 @@ int main(int argc, char **argv) {
 #endif
 
     QApplication app(argc, argv);
-    QElapsedTimer timer;
-    timer.start();
+    // Нужны QSettings (недавние наборы) и QStandardPaths (кэш)
+    QCoreApplication::setOrganizationName("SolarSensors");
+    QCoreApplication::setApplicationName("SolarSensors");
 
     SensorModel model;
+    qmlRegisterType<SensorPlot>("SolarSensors", 1, 0, "SensorPlot");
 
     QString appPath = QCoreApplication::applicationDirPath();
     QString qmlPath = QDir(appPath).filePath("Main.qml");
@@ -43,7 +49,25 @@ int main(int argc, char **argv) {
     view->setSource(QUrl::fromLocalFile(qmlPath));
 
     layout->addWidget(view);
+
+    // Отрисованный кадр закрывает замер графика (fillSeries + chartRedraw),
+    // первый кадр - время запуска до появления окна
+    QObject::connect(view->quickWindow(), &QQuickWindow::afterRendering, &model, &SensorModel::onFrameRendered);
+    QObject::connect(view->quickWindow(), &QQuickWindow::afterRendering, &model, [startUs]() {
+        TraceEvent startup;
+        startup.name = "startup";
+        startup.category = "app";
+        startup.startUs = startUs;
+        startup.durationUs = Tracer::nowUs() - startUs;
+        startup.memoryBytes = Tracer::memoryBytes();
+        startup.peakBytes = Tracer::peakMemoryBytes();
+        Tracer::instance().record(startup);
+        qInfo() << "First frame in" << startup.durationUs / 1000 << "ms";
+    }, Qt::SingleShotConnection);
+
     window.show();
 
+    model.restoreLastSession();
+
     return app.exec();
 }
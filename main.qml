@@ -3,6 +3,7 @@ import QtQuick.Controls
 import QtQuick.Layouts
 import QtCharts
 import Qt.labs.platform as Platform
+import SolarSensors 1.0
 
 Rectangle {
     id: root
@@ -12,6 +13,16 @@ Rectangle {
     property int currentIndex: -1
     property string viewMode: "raw"
     property var currentStats: null
+    property var windowStats: null // статистика видимого окна выбранного датчика
+
+    // Видимое окно по времени (зум колесом, прокрутка перетаскиванием)
+    property real viewMinTime: sensorModel.minTime
+    property real viewMaxTime: sensorModel.maxTime
+    // Окно показывает все данные / упирается в правый край (для слежения за файлом)
+    property bool viewFull: true
+    property bool viewAtEnd: true
+    property var chartSeries: []
+    property bool showTrace: false // оверлей с замерами стадий (F12)
 
     // Функция безопасного форматирования
     function formatVal(val, points, prefix, suffix) {
@@ -22,11 +33,6 @@ Rectangle {
         return (prefix || "") + res + (suffix || "");
     }
 
-    function getSensorColor(idx) {
-        if (idx < 0) return "black";
-        return Qt.hsla((idx * 0.618033988749895) % 1.0, 0.75, 0.5, 1.0);
-    }
-
     ColumnLayout {
         anchors.fill: parent
         spacing: 0
@@ -43,9 +49,44 @@ Rectangle {
                     contentItem: Text { text: parent.text; color: "white"; font.bold: true; verticalAlignment: Text.AlignVCenter; horizontalAlignment: Text.AlignHCenter }
                     onClicked: fileMenu.open()
                     Menu { id: fileMenu; y: parent.height
-                        MenuItem { text: "Импорт (.txt)"; onTriggered: openDialog.open() }
-                        MenuItem { text: "Экспорт (.csv)"; onTriggered: saveDialog.open() }
-                        MenuItem { text: "Экспорт JSON (с коэфф.)"; onTriggered: saveJsonDialog.open() }
+                        MenuItem { text: "Импорт (.txt)"; enabled: !sensorModel.busy; onTriggered: { openDialog.follow = false; openDialog.open() } }
+                        MenuItem { text: "Следить за файлом (.txt)"; enabled: !sensorModel.busy; onTriggered: { openDialog.follow = true; openDialog.open() } }
+                        MenuItem { text: "Склеить прогоны (.txt…)"; enabled: !sensorModel.busy; onTriggered: { sessionDialog.overlay = false; sessionDialog.open() } }
+                        MenuItem { text: "Сравнить прогоны (.txt…)"; enabled: !sensorModel.busy; onTriggered: { sessionDialog.overlay = true; sessionDialog.open() } }
+                        MenuItem { text: "Остановить слежение"; enabled: sensorModel.following; onTriggered: sensorModel.stopFollowing() }
+                        Menu {
+                            id: recentMenu
+                            title: "Недавние"
+                            enabled: !sensorModel.busy && sensorModel.recentDatasets.length > 0
+                            Instantiator {
+                                model: sensorModel.recentDatasets
+                                delegate: MenuItem {
+                                    text: modelData
+                                    onTriggered: sensorModel.importFromTxtAsync(modelData)
+                                }
+                                onObjectAdded: function(index, object) { recentMenu.insertItem(index, object) }
+                                onObjectRemoved: function(index, object) { recentMenu.removeItem(object) }
+                            }
+                        }
+                        MenuItem { text: "Экспорт (.csv)"; enabled: !sensorModel.busy; onTriggered: { saveDialog.options = ({}); saveDialog.open() } }
+                        MenuItem { text: "Экспорт видимого (.csv)"; enabled: !sensorModel.busy; onTriggered: { saveDialog.options = visibleCsvOptions(); saveDialog.open() } }
+                        MenuItem { text: "Экспорт JSON (с коэфф.)"; enabled: !sensorModel.busy; onTriggered: { saveJsonDialog.compact = false; saveJsonDialog.open() } }
+                        MenuItem { text: "Экспорт JSON (компактный)"; enabled: !sensorModel.busy; onTriggered: { saveJsonDialog.compact = true; saveJsonDialog.open() } }
+                        MenuItem { text: "Экспорт колонок (.scol)"; enabled: !sensorModel.busy; onTriggered: saveColumnsDialog.open() }
+                        Menu {
+                            id: resampleMenu
+                            title: "Экспорт CSV с шагом"
+                            enabled: !sensorModel.busy
+                            Instantiator {
+                                model: [1, 10, 60, 600]
+                                delegate: MenuItem {
+                                    text: modelData < 60 ? modelData + " с" : (modelData / 60) + " мин"
+                                    onTriggered: { saveDialog.options = ({ step: modelData }); saveDialog.open() }
+                                }
+                                onObjectAdded: function(index, object) { resampleMenu.insertItem(index, object) }
+                                onObjectRemoved: function(index, object) { resampleMenu.removeItem(object) }
+                            }
+                        }
                     }
                 }
 
@@ -55,8 +96,44 @@ Rectangle {
                     contentItem: Text { text: parent.text; color: "white"; font.bold: true; verticalAlignment: Text.AlignVCenter; horizontalAlignment: Text.AlignHCenter }
                     onClicked: viewMenu.open()
                     Menu { id: viewMenu; y: parent.height
-                        MenuItem { text: "Сырые данные"; checkable: true; checked: root.viewMode==="raw"; onTriggered: { root.viewMode="raw"; updateChart() } }
-                        MenuItem { text: "Скорректированные"; checkable: true; checked: root.viewMode==="corrected"; onTriggered: { root.viewMode="corrected"; updateChart() } }
+                        MenuItem { text: "Сырые данные"; checkable: true; checked: root.viewMode==="raw"; onTriggered: { root.viewMode="raw"; refillVisible() } }
+                        MenuItem { text: "Скорректированные"; checkable: true; checked: root.viewMode==="corrected"; onTriggered: { root.viewMode="corrected"; refillVisible() } }
+                        MenuSeparator {}
+                        MenuItem { text: "Производительность (F12)"; checkable: true; checked: root.showTrace; onTriggered: root.showTrace = !root.showTrace }
+                        MenuItem { text: "Корреляции каналов"; enabled: !sensorModel.busy; onTriggered: sensorModel.computeCorrelationAsync() }
+                        MenuSeparator {}
+                        Menu {
+                            id: memoryMenu
+                            title: "Лимит памяти на набор"
+                            Instantiator {
+                                model: [0, 1024, 2048, 4096, 8192]
+                                delegate: MenuItem {
+                                    text: modelData === 0 ? "Без лимита" : (modelData / 1024) + " ГБ"
+                                    checkable: true; checked: sensorModel.memoryLimitMb === modelData
+                                    onTriggered: sensorModel.memoryLimitMb = modelData
+                                }
+                                onObjectAdded: function(index, object) { memoryMenu.insertItem(index, object) }
+                                onObjectRemoved: function(index, object) { memoryMenu.removeItem(object) }
+                            }
+                        }
+                        MenuItem { text: "Сжимать колонки в памяти"; checkable: true; checked: sensorModel.compressColumns; onTriggered: sensorModel.compressColumns = !sensorModel.compressColumns }
+                        MenuSeparator {}
+                        Menu {
+                            id: calibrationMenu
+                            title: "Окно калибровки"
+                            enabled: !sensorModel.busy
+                            Instantiator {
+                                model: [0, 300, 900, 3600, 21600]
+                                delegate: MenuItem {
+                                    text: modelData === 0 ? "Весь набор" : (modelData < 3600 ? (modelData / 60) + " мин" : (modelData / 3600) + " ч")
+                                    checkable: true; checked: sensorModel.calibrationWindow === modelData
+                                    onTriggered: sensorModel.calibrationWindow = modelData
+                                }
+                                onObjectAdded: function(index, object) { calibrationMenu.insertItem(index, object) }
+                                onObjectRemoved: function(index, object) { calibrationMenu.removeItem(object) }
+                            }
+                        }
+                        MenuItem { text: "Без неисправных в эталоне"; checkable: true; checked: sensorModel.excludeAnomalous; enabled: !sensorModel.busy; onTriggered: sensorModel.excludeAnomalous = !sensorModel.excludeAnomalous }
                     }
                 }
 
@@ -65,6 +142,21 @@ Rectangle {
                     text: root.viewMode === "raw" ? "РЕЖИМ: СЫРЫЕ" : "РЕЖИМ: КОРРЕКЦИЯ"
                     color: root.viewMode === "raw" ? "#ffc107" : "#28a745"; font.bold: true
                 }
+                Text {
+                    anchors.verticalCenter: parent.verticalCenter; leftPadding: 20
+                    visible: sensorModel.following
+                    text: "● СЛЕЖЕНИЕ"; color: "#dc3545"; font.bold: true
+                }
+                Text {
+                    anchors.verticalCenter: parent.verticalCenter; leftPadding: 20
+                    visible: sensorModel.outOfCore
+                    text: "● НА ДИСКЕ"; color: "#17a2b8"; font.bold: true
+                }
+                Text {
+                    anchors.verticalCenter: parent.verticalCenter; leftPadding: 20
+                    visible: sensorModel.compressionRatio > 0
+                    text: "● СЖАТО ×" + sensorModel.compressionRatio.toFixed(1); color: "#6f42c1"; font.bold: true
+                }
             }
         }
 
@@ -86,8 +178,13 @@ Rectangle {
                         delegate: Rectangle {
                             width: ListView.view.width; height: 40; color: root.currentIndex===index?"#e7f1ff":"white"
                             RowLayout { anchors.fill: parent; anchors.leftMargin: 10
-                                Rectangle { width: 10; height: 10; radius: 5; color: getSensorColor(index) }
+                                Rectangle { width: 10; height: 10; radius: 5; color: sensorModel.sensorColor(index) }
                                 Text { text: sensorName; font.bold: root.currentIndex===index }
+                                Text {
+                                    visible: sensorAnomalies !== ""
+                                    text: "⚠ " + sensorAnomalies
+                                    font.pixelSize: 10; color: "#d9534f"; elide: Text.ElideRight; Layout.fillWidth: true
+                                }
                             }
                             MouseArea { anchors.fill: parent; onClicked: { root.currentIndex=index; updateChart() } }
                         }
@@ -102,13 +199,18 @@ Rectangle {
                     id: chart; anchors.fill: parent; antialiasing: true;
                     animationOptions: ChartView.NoAnimation;
                     legend.alignment: Qt.AlignBottom
+                    // Все датчики - цвета видны в списке слева, легенда на сотни строк не нужна
+                    legend.visible: root.currentIndex !== -1
+
+                    // Число точек серии зависит от ширины - перестраиваем после ресайза
+                    onPlotAreaChanged: resizeTimer.restart()
 
                     ValueAxis {
                         id: axisX
                         titleText: "Время (с)"
                         labelFormat: "%.1f"
-                        min: sensorModel.minTime
-                        max: sensorModel.maxTime
+                        min: root.viewMinTime
+                        max: root.viewMaxTime
                         tickCount: 10
                     }
                     ValueAxis {
@@ -120,6 +222,49 @@ Rectangle {
                         tickCount: 5
                     }
                 }
+
+                // Все датчики: кривые рисует SensorPlot поверх области графика,
+                // у ChartView остаются оси (пустая серия) и сетка
+                SensorPlot {
+                    x: chart.x + chart.plotArea.x; y: chart.y + chart.plotArea.y
+                    width: chart.plotArea.width; height: chart.plotArea.height
+                    clip: true
+                    visible: root.currentIndex === -1
+                    model: visible ? sensorModel : null
+                    corrected: root.viewMode === "corrected"
+                    minTime: root.viewMinTime; maxTime: root.viewMaxTime
+                    minValue: axisY.min; maxValue: axisY.max
+                }
+
+                // Зум колесом вокруг курсора, прокрутка перетаскиванием, сброс двойным кликом
+                MouseArea {
+                    anchors.fill: chart
+                    property real pressX: 0
+                    property real pressMin: 0
+                    property real pressMax: 0
+
+                    function timeAt(x) {
+                        var area = chart.plotArea;
+                        var frac = Math.max(0, Math.min(1, (x - area.x) / area.width));
+                        return root.viewMinTime + frac * (root.viewMaxTime - root.viewMinTime);
+                    }
+
+                    onWheel: function(wheel) {
+                        var factor = wheel.angleDelta.y > 0 ? 0.8 : 1.25;
+                        var center = timeAt(wheel.x);
+                        setView(center - (center - root.viewMinTime) * factor,
+                                center + (root.viewMaxTime - center) * factor);
+                    }
+                    onPressed: function(mouse) {
+                        pressX = mouse.x; pressMin = root.viewMinTime; pressMax = root.viewMaxTime;
+                    }
+                    onPositionChanged: function(mouse) {
+                        if (!pressed) return;
+                        var shift = (pressX - mouse.x) / chart.plotArea.width * (pressMax - pressMin);
+                        setView(pressMin + shift, pressMax + shift);
+                    }
+                    onDoubleClicked: resetView()
+                }
             }
 
             // 3. СТАТИСТИКА
@@ -170,6 +315,17 @@ Rectangle {
                                     text: "(отклонение от нормы)";
                                     font.pixelSize: 10; color: "#888"; wrapMode: Text.WordWrap; Layout.fillWidth: true
                                 }
+                                Text {
+                                    visible: root.currentStats && root.currentStats.anomalous > 0
+                                    text: root.currentStats ? "С неисправностями: " + root.currentStats.anomalous
+                                                              + (root.currentStats.excludeAnomalous ? " (не входят в эталон)" : "") : ""
+                                    font.pixelSize: 11; color: "#d9534f"; wrapMode: Text.WordWrap; Layout.fillWidth: true
+                                }
+                                Text {
+                                    visible: root.currentStats && root.currentStats.rollingWindow > 0
+                                    text: root.currentStats ? "Скользящая калибровка: окно " + formatVal(root.currentStats.rollingWindow / 60, 0, "", " мин") : ""
+                                    font.pixelSize: 11; color: "#666"; wrapMode: Text.WordWrap; Layout.fillWidth: true
+                                }
                             }
 
                             // --- Режим: ОДИН СЕНСОР ---
@@ -178,11 +334,20 @@ Rectangle {
                                 spacing: 8
                                 Text { text: "Выбран сенсор:"; font.bold: true; color: "#555" }
                                 Text { text: root.currentStats ? root.currentStats.name : ""; font.pointSize: 12; font.bold: true }
+                                Text {
+                                    visible: root.currentStats && root.currentStats.anomaliesA !== undefined
+                                             && (root.currentStats.anomaliesA.length > 0 || root.currentStats.anomaliesB.length > 0)
+                                    text: root.currentStats && root.currentStats.anomaliesA !== undefined
+                                          ? "⚠ A: " + (root.currentStats.anomaliesA.join(", ") || "норма")
+                                            + "; B: " + (root.currentStats.anomaliesB.join(", ") || "норма")
+                                            + (root.currentStats.excluded ? "\nНе входит в эталон" : "") : ""
+                                    font.pixelSize: 11; color: "#d9534f"; wrapMode: Text.WordWrap; Layout.fillWidth: true
+                                }
 
                                 Rectangle { Layout.fillWidth: true; height: 1; color: "#eee" }
 
                                 // Канал A
-                                Text { text: "Канал A (Сплошной):"; color: getSensorColor(root.currentIndex); font.bold: true }
+                                Text { text: "Канал A (Сплошной):"; color: sensorModel.sensorColor(root.currentIndex); font.bold: true }
                                 RowLayout {
                                     Text { text: "Коэфф:"; color: "#555" }
                                     Text {
@@ -202,10 +367,16 @@ Rectangle {
                                     text: "Среднее сырое: " + (root.currentStats ? formatVal(root.currentStats.avgRawA, 1) : "")
                                     font.pixelSize: 11; color: "#666"
                                 }
+                                Text {
+                                    visible: root.windowStats !== null && root.windowStats.countA > 0
+                                    text: root.windowStats ? "В окне: " + formatVal(root.windowStats.meanA, 1) + " ± " + formatVal(root.windowStats.stddevA, 1)
+                                                             + "\n" + formatVal(root.windowStats.minA, 0) + " … " + formatVal(root.windowStats.maxA, 0) : ""
+                                    font.pixelSize: 11; color: "#666"
+                                }
                                 Item { height: 8; width: 1 }
 
                                 // Канал B
-                                Text { text: "Канал B (Пунктир):"; color: Qt.lighter(getSensorColor(root.currentIndex), 1.5); font.bold: true }
+                                Text { text: "Канал B (Пунктир):"; color: Qt.lighter(sensorModel.sensorColor(root.currentIndex), 1.5); font.bold: true }
                                 RowLayout {
                                     Text { text: "Коэфф:"; color: "#555" }
                                     Text {
@@ -225,6 +396,62 @@ Rectangle {
                                     text: "Среднее сырое: " + (root.currentStats ? formatVal(root.currentStats.avgRawB, 1) : "")
                                     font.pixelSize: 11; color: "#666"
                                 }
+                                Text {
+                                    visible: root.windowStats !== null && root.windowStats.countB > 0
+                                    text: root.windowStats ? "В окне: " + formatVal(root.windowStats.meanB, 1) + " ± " + formatVal(root.windowStats.stddevB, 1)
+                                                             + "\n" + formatVal(root.windowStats.minB, 0) + " … " + formatVal(root.windowStats.maxB, 0) : ""
+                                    font.pixelSize: 11; color: "#666"
+                                }
+
+                                // Дрейф коэффициентов при скользящей калибровке
+                                ColumnLayout {
+                                    visible: driftCanvas.timeline.length > 1
+                                    Layout.fillWidth: true
+                                    spacing: 4
+                                    Rectangle { Layout.fillWidth: true; height: 1; color: "#eee" }
+                                    Text { text: "Коэфф. во времени:"; color: "#555"; font.bold: true }
+                                    Canvas {
+                                        id: driftCanvas
+                                        Layout.fillWidth: true; Layout.preferredHeight: 60
+                                        property var timeline: (root.currentStats && root.currentStats.timeline) ? root.currentStats.timeline : []
+                                        property real kMin: 0
+                                        property real kMax: 0
+                                        onTimelineChanged: {
+                                            var lo = Infinity, hi = -Infinity;
+                                            for (var i = 0; i < timeline.length; ++i) {
+                                                lo = Math.min(lo, timeline[i].kA, timeline[i].kB);
+                                                hi = Math.max(hi, timeline[i].kA, timeline[i].kB);
+                                            }
+                                            kMin = lo; kMax = hi;
+                                            requestPaint();
+                                        }
+                                        onWidthChanged: requestPaint()
+                                        onPaint: {
+                                            var ctx = getContext("2d");
+                                            ctx.clearRect(0, 0, width, height);
+                                            if (timeline.length < 2) return;
+                                            var span = Math.max(kMax - kMin, 1e-9);
+                                            var self = this;
+                                            function line(key, color) {
+                                                ctx.strokeStyle = color;
+                                                ctx.beginPath();
+                                                for (var i = 0; i < self.timeline.length; ++i) {
+                                                    var x = i * self.width / (self.timeline.length - 1);
+                                                    var y = self.height - 2 - (self.timeline[i][key] - self.kMin) / span * (self.height - 4);
+                                                    if (i === 0) ctx.moveTo(x, y); else ctx.lineTo(x, y);
+                                                }
+                                                ctx.stroke();
+                                            }
+                                            ctx.lineWidth = 1.5;
+                                            line("kA", sensorModel.sensorColor(root.currentIndex));
+                                            line("kB", Qt.lighter(sensorModel.sensorColor(root.currentIndex), 1.5));
+                                        }
+                                    }
+                                    Text {
+                                        text: formatVal(driftCanvas.kMin, 4, "x") + " … " + formatVal(driftCanvas.kMax, 4, "x")
+                                        font.pixelSize: 11; color: "#666"
+                                    }
+                                }
                             }
                             Item { Layout.fillHeight: true }
                         }
@@ -234,39 +461,270 @@ Rectangle {
         }
     }
 
-    Platform.FileDialog { id: openDialog; nameFilters: ["Text (*.txt)"]; onAccepted: { sensorModel.importFromTxt(file.toString()); updateChart(); } }
-    Platform.FileDialog { id: saveDialog; fileMode: Platform.FileDialog.SaveFile; nameFilters: ["CSV (*.csv)"]; onAccepted: { sensorModel.exportToCsv(file.toString()); } }
-    Platform.FileDialog { id: saveJsonDialog; fileMode: Platform.FileDialog.SaveFile; nameFilters: ["JSON (*.json)"]; onAccepted: { sensorModel.exportToJson(file.toString()); } }
+    // ПРОГРЕСС ФОНОВОЙ ОПЕРАЦИИ
+    Rectangle {
+        id: progressPanel
+        visible: sensorModel.busy
+        anchors.horizontalCenter: parent.horizontalCenter; anchors.bottom: parent.bottom; anchors.bottomMargin: 20
+        width: 360; height: 90; radius: 6; z: 200
+        color: "white"; border.color: "#ccc"
 
-    function updateChart() {
-        chart.removeAllSeries();
-        var isCorrected = (root.viewMode === "corrected");
-
-        if(currentIndex === -1) {
-            var count = sensorModel.rowCount();
-            for(var i=0; i < count; i++) {
-                var idx = sensorModel.index(i,0);
-                var sName = sensorModel.data(idx, 258);
-                var s = chart.createSeries(ChartView.SeriesTypeLine, sName, axisX, axisY);
-                s.color = getSensorColor(i);
-                s.width = 2;
-                sensorModel.fillSeries(s, i, isCorrected, "A");
+        ColumnLayout {
+            anchors.fill: parent; anchors.margins: 12; spacing: 6
+            Text { text: sensorModel.progressText; font.bold: true; color: "#343a40" }
+            ProgressBar {
+                Layout.fillWidth: true
+                from: 0; to: 1
+                value: sensorModel.progress
+                indeterminate: sensorModel.progressTotal <= 0
+            }
+            Button {
+                text: "Отмена"; Layout.alignment: Qt.AlignRight
+                onClicked: sensorModel.cancelOperation()
             }
+        }
+    }
+
+    // ЗАМЕРЫ СТАДИЙ: последний прогон каждой стадии конвейера
+    Shortcut { sequence: "F12"; onActivated: root.showTrace = !root.showTrace }
+
+    Rectangle {
+        id: tracePanel
+        visible: root.showTrace
+        anchors.right: parent.right; anchors.top: parent.top; anchors.topMargin: 45; anchors.rightMargin: 10
+        width: 460; height: traceColumn.implicitHeight + 20; radius: 6; z: 150
+        color: "#e6343a40"
+
+        property var stages: sensorModel.traceStages
+        property real maxMs: {
+            var m = 0;
+            for (var i = 0; i < stages.length; ++i) m = Math.max(m, stages[i].ms);
+            return m;
+        }
+
+        function formatSize(bytes) {
+            if (bytes < 0) return "";
+            if (bytes >= 1048576) return (bytes / 1048576).toFixed(1) + " MB";
+            return (bytes / 1024).toFixed(1) + " KB";
+        }
+        function details(s) {
+            var parts = [];
+            if (s.rows >= 0) parts.push(s.rows + " стр.");
+            if (s.bytes >= 0) parts.push(formatSize(s.bytes));
+            parts.push("пик " + s.peakMb.toFixed(0) + " MB" + (s.peakGrowthMb > 0.05 ? " (+" + s.peakGrowthMb.toFixed(1) + ")" : ""));
+            return parts.join(", ");
+        }
+
+        ColumnLayout {
+            id: traceColumn
+            anchors.left: parent.left; anchors.right: parent.right; anchors.top: parent.top; anchors.margins: 10
+            spacing: 4
+
+            RowLayout {
+                Layout.fillWidth: true
+                Text { text: "Стадии (последний прогон)"; color: "white"; font.bold: true; Layout.fillWidth: true }
+                Button { text: "Trace…"; onClicked: saveTraceDialog.open() }
+                Button { text: "Сброс"; onClicked: sensorModel.clearTrace() }
+            }
+            Text { visible: tracePanel.stages.length === 0; text: "Нет замеров"; color: "#ccc" }
+
+            Repeater {
+                model: tracePanel.stages
+                delegate: ColumnLayout {
+                    Layout.fillWidth: true; spacing: 1
+                    RowLayout {
+                        Layout.fillWidth: true
+                        Text { text: modelData.name; color: "white"; font.pixelSize: 12; Layout.preferredWidth: 130 }
+                        Rectangle {
+                            Layout.fillWidth: true; Layout.preferredHeight: 10; color: "#555"
+                            Rectangle {
+                                height: parent.height; color: modelData.category === "load" ? "#6c757d" : "#17a2b8"
+                                width: tracePanel.maxMs > 0 ? parent.width * modelData.ms / tracePanel.maxMs : 0
+                            }
+                        }
+                        Text { text: modelData.ms.toFixed(1) + " ms"; color: "white"; font.pixelSize: 12
+                               horizontalAlignment: Text.AlignRight; Layout.preferredWidth: 80 }
+                    }
+                    Text { text: tracePanel.details(modelData); color: "#bbb"; font.pixelSize: 10; leftPadding: 4 }
+                }
+            }
+        }
+    }
+
+    Connections {
+        target: sensorModel
+        function onOperationFinished(operation, ok) {
+            if ((operation === "import" || operation === "calibrate") && ok) updateChart()
+            if (operation === "correlation" && ok) correlationPopup.open()
+        }
+        function onDatasetReplaced() { resetView() }
+        // Эталон пересчитан сразу (без фоновой задачи): коэффициенты и статистика новые
+        function onExcludeAnomalousChanged() { if (!sensorModel.busy) updateChart() }
+        function onDataAppended() {
+            // Новые датчики SensorPlot подхватывает сам, серии только перезаполняются
+            followView();
+            root.currentStats = sensorModel.getSensorStats(currentIndex);
+        }
+    }
+
+    // КОРРЕЛЯЦИИ КАНАЛОВ: тепловая карта r, синий - обратная связь, красный - прямая
+    Popup {
+        id: correlationPopup
+        anchors.centerIn: parent
+        width: Math.min(parent.width - 40, 720); height: Math.min(parent.height - 40, 760)
+        modal: true; z: 300
+        property string hint: ""
+
+        function cellColor(r) {
+            if (isNaN(r)) return "#adb5bd";
+            var a = Math.min(1, Math.abs(r));
+            return r >= 0 ? Qt.rgba(1, 1 - a, 1 - a, 1) : Qt.rgba(1 - a, 1 - a, 1, 1);
+        }
+
+        ColumnLayout {
+            anchors.fill: parent; spacing: 6
+            RowLayout {
+                Layout.fillWidth: true
+                Text { text: "Корреляции каналов (" + sensorModel.correlation.channelCount + ")"; font.bold: true; Layout.fillWidth: true }
+                Button { text: "Закрыть"; onClicked: correlationPopup.close() }
+            }
+            Text { text: correlationPopup.hint.length > 0 ? correlationPopup.hint : "Наведите на ячейку"; color: "#343a40"; font.pixelSize: 12 }
+            TableView {
+                id: correlationTable
+                Layout.fillWidth: true; Layout.fillHeight: true
+                clip: true
+                model: sensorModel.correlation
+                // Ячейки мельче при сотнях каналов, но не меньше 4 px
+                property real cell: Math.max(4, Math.min(24, Math.floor(width / Math.max(1, sensorModel.correlation.channelCount))))
+                columnWidthProvider: function(column) { return cell }
+                rowHeightProvider: function(row) { return cell }
+                onCellChanged: forceLayout()
+                delegate: Rectangle {
+                    implicitWidth: correlationTable.cell; implicitHeight: correlationTable.cell
+                    color: correlationPopup.cellColor(value)
+                    MouseArea {
+                        anchors.fill: parent; hoverEnabled: true
+                        onEntered: correlationPopup.hint = rowName + " / " + columnName + ": r = "
+                                                           + (isNaN(value) ? "нет данных" : value.toFixed(3))
+                    }
+                }
+            }
+            RowLayout {
+                spacing: 4
+                Text { text: "−1"; font.pixelSize: 11 }
+                Repeater {
+                    model: 11
+                    Rectangle { width: 16; height: 10; color: correlationPopup.cellColor(index / 5 - 1) }
+                }
+                Text { text: "+1"; font.pixelSize: 11 }
+                Rectangle { width: 16; height: 10; color: correlationPopup.cellColor(NaN); Layout.leftMargin: 12 }
+                Text { text: "нет разброса"; font.pixelSize: 11 }
+            }
+        }
+    }
+
+    Platform.FileDialog { id: openDialog; property bool follow: false; nameFilters: ["Text (*.txt)"]
+        onAccepted: { if (follow) sensorModel.followFile(file.toString()); else sensorModel.importFromTxtAsync(file.toString()); } }
+    Platform.FileDialog { id: sessionDialog; property bool overlay: false; fileMode: Platform.FileDialog.OpenFiles; nameFilters: ["Text (*.txt)"]
+        onAccepted: {
+            var urls = [];
+            for (var i = 0; i < files.length; i++) urls.push(files[i].toString());
+            sensorModel.importSessionAsync(urls, overlay);
+        } }
+    Platform.FileDialog { id: saveDialog; property var options: ({}); fileMode: Platform.FileDialog.SaveFile; nameFilters: ["CSV (*.csv)"]; onAccepted: { sensorModel.exportToCsvAsync(file.toString(), options); } }
+    Platform.FileDialog { id: saveJsonDialog; property bool compact: false; fileMode: Platform.FileDialog.SaveFile; nameFilters: ["JSON (*.json)"]; onAccepted: { sensorModel.exportToJsonAsync(file.toString(), compact); } }
+    Platform.FileDialog { id: saveColumnsDialog; fileMode: Platform.FileDialog.SaveFile; nameFilters: ["Колонки (*.scol)"]; onAccepted: { sensorModel.exportToColumnsAsync(file.toString()); } }
+    Platform.FileDialog { id: saveTraceDialog; fileMode: Platform.FileDialog.SaveFile; nameFilters: ["Chrome trace (*.json)"]; onAccepted: { sensorModel.exportTrace(file.toString()); } }
+
+    // То, что сейчас на графике: режим, выбранный датчик и видимое окно времени
+    function visibleCsvOptions() {
+        var opts = { raw: root.viewMode === "raw", corrected: root.viewMode === "corrected",
+                     tFrom: viewMinTime, tTo: viewMaxTime };
+        if (currentIndex !== -1) opts.sensors = [ sensorModel.data(sensorModel.index(currentIndex, 0), 257) ];
+        return opts;
+    }
+
+    function plotWidth() {
+        return Math.max(1, Math.round(chart.plotArea.width));
+    }
+
+    // Окно не выходит за границы данных и не сжимается до нуля
+    function setView(tMin, tMax) {
+        var full = sensorModel.maxTime - sensorModel.minTime;
+        var span = Math.max(tMax - tMin, full * 1e-6, 1e-9);
+        if (span >= full) { resetView(); return; }
+        if (tMin < sensorModel.minTime) tMin = sensorModel.minTime;
+        if (tMin + span > sensorModel.maxTime) tMin = sensorModel.maxTime - span;
+        root.viewMinTime = tMin;
+        root.viewMaxTime = tMin + span;
+        root.viewFull = false;
+        root.viewAtEnd = (tMin + span >= sensorModel.maxTime - span * 1e-3);
+        viewTimer.start();
+    }
+
+    function resetView() {
+        root.viewMinTime = sensorModel.minTime;
+        root.viewMaxTime = sensorModel.maxTime;
+        root.viewFull = true;
+        root.viewAtEnd = true;
+        viewTimer.start();
+    }
+
+    // Данные дописались: полное окно растет вместе с ними, окно у правого края
+    // едет за новыми точками, остальное остается на месте
+    function followView() {
+        if (root.viewFull) resetView();
+        else if (root.viewAtEnd) setView(sensorModel.maxTime - (root.viewMaxTime - root.viewMinTime), sensorModel.maxTime);
+        else viewTimer.start();
+    }
+
+    // Перезаполнить существующие серии видимым окном (без пересоздания) - один вызов в C++,
+    // серии, для которых ничего не поменялось, он пропускает
+    function refillVisible() {
+        sensorModel.updateSeries(chartSeries, root.viewMode === "corrected",
+                                 root.viewMinTime, root.viewMaxTime, 2 * plotWidth());
+        updateWindowStats();
+    }
+
+    // Суммы по окну считаются за O(1) из префиксов - можно на каждый кадр зума
+    function updateWindowStats() {
+        root.windowStats = (currentIndex === -1) ? null
+                         : sensorModel.getWindowStats(currentIndex, root.viewMinTime, root.viewMaxTime);
+    }
+
+    // Серии переиспользуются: создаются только недостающие, лишние удаляются,
+    // у остальных меняются подпись и оформление
+    function updateChart() {
+        var specs = [];
+        if (currentIndex === -1) {
+            // Кривые всех датчиков - в SensorPlot; пустая серия держит оси
+            specs.push({ name: "", index: -1, channel: "A", color: "transparent", width: 1, style: Qt.SolidLine });
         } else {
-            var sA = chart.createSeries(ChartView.SeriesTypeLine, "Канал A", axisX, axisY);
-            sA.color = getSensorColor(currentIndex);
-            sA.width = 3;
-            sensorModel.fillSeries(sA, currentIndex, isCorrected, "A");
-
-            var sB = chart.createSeries(ChartView.SeriesTypeLine, "Канал B", axisX, axisY);
-            sB.color = Qt.lighter(sA.color, 1.5);
-            sB.width = 3;
-            sB.style = Qt.DashLine;
-            sensorModel.fillSeries(sB, currentIndex, isCorrected, "B");
+            var color = sensorModel.sensorColor(currentIndex);
+            specs.push({ name: "Канал A", index: currentIndex, channel: "A", color: color, width: 3, style: Qt.SolidLine });
+            specs.push({ name: "Канал B", index: currentIndex, channel: "B", color: Qt.lighter(color, 1.5), width: 3, style: Qt.DashLine });
+        }
+
+        var entries = [];
+        for (var k = 0; k < specs.length; k++) {
+            var spec = specs[k];
+            var s = (k < chartSeries.length) ? chartSeries[k].series
+                                             : chart.createSeries(ChartView.SeriesTypeLine, spec.name, axisX, axisY);
+            s.name = spec.name;
+            s.color = spec.color;
+            s.width = spec.width;
+            s.style = spec.style;
+            entries.push({ series: s, index: spec.index, channel: spec.channel });
         }
+        for (var r = specs.length; r < chartSeries.length; r++) chart.removeSeries(chartSeries[r].series);
+        chartSeries = entries;
+        refillVisible();
         root.currentStats = sensorModel.getSensorStats(currentIndex);
     }
 
     Component.onCompleted: updateTimer.start()
     Timer { id: updateTimer; interval: 200; onTriggered: updateChart() }
+    Timer { id: resizeTimer; interval: 150; onTriggered: refillVisible() }
+    // Зум и прокрутка: не чаще одного перезаполнения за кадр (~60 fps)
+    Timer { id: viewTimer; interval: 16; onTriggered: refillVisible() }
 }
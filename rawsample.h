@@ -0,0 +1,19 @@
+#ifndef RAWSAMPLE_H
+#define RAWSAMPLE_H
+
+#include <cmath>
+#include <limits>
+
+// Тип сырых отсчетов. Счетчики целые, поэтому float32 (до 2^24) их не теряет,
+// а памяти занимает вдвое меньше. Включается опцией SOLAR_RAW_FLOAT32 в CMake.
+#ifdef SOLAR_RAW_FLOAT32
+using RawSample = float;
+#else
+using RawSample = double;
+#endif
+
+// Пропуск: в строке файла не было колонок этого датчика
+inline RawSample gapSample() { return std::numeric_limits<RawSample>::quiet_NaN(); }
+inline bool isGap(RawSample v) { return std::isnan(v); }
+
+#endif // RAWSAMPLE_H
@@ -0,0 +1,173 @@
+#include "samplecolumn.h"
+
+namespace {
+
+constexpr qsizetype kChunk = ChunkStore::kChunkSamples;
+
+// Подменяет кусок, который не удалось прочитать: отсчеты становятся пропусками.
+// ChunkStore при этом пишет предупреждение и поднимает hasError(), по которому
+// операции над набором (SensorDataset::storageFailed) отказываются от результата
+const RawSample *gapChunk() {
+    static const QVector<RawSample> gaps(kChunk, gapSample());
+    return gaps.constData();
+}
+
+} // namespace
+
+const RawSample *SampleColumn::constData() const {
+    Q_ASSERT(!isPaged());
+    return m_data.constData();
+}
+
+RawSample SampleColumn::pagedAt(qsizetype i) const {
+    qsizetype first = 0, count = 0;
+    ChunkStore::Chunk hold;
+    const RawSample *data = span(i, first, count, hold);
+    return data[i - first];
+}
+
+const RawSample *SampleColumn::span(qsizetype i, qsizetype &first, qsizetype &count,
+                                    ChunkStore::Chunk &hold) const {
+    if (!isPaged()) {
+        first = 0;
+        count = m_data.size();
+        return m_data.constData();
+    }
+
+    const qsizetype p = m_start + i;
+    const qsizetype c = p / kChunk;
+    if (c < m_chunks.size()) {
+        hold = m_store->read(m_chunks.at(c));
+        const qsizetype physFirst = std::max(c * kChunk, m_start);
+        first = physFirst - m_start;
+        count = std::min((c + 1) * kChunk, m_start + m_size) - physFirst;
+        const RawSample *base = hold ? hold->constData() : gapChunk();
+        return base + (physFirst - c * kChunk);
+    }
+
+    const qsizetype tailStart = m_chunks.size() * kChunk;
+    const qsizetype physFirst = std::max(tailStart, m_start);
+    first = physFirst - m_start;
+    count = m_start + m_size - physFirst;
+    return m_tail.constData() + (physFirst - tailStart);
+}
+
+RawSample SampleColumn::Cursor::load(qsizetype i) {
+    m_data = m_column->span(i, m_first, m_count, m_chunk);
+    return m_data[i - m_first];
+}
+
+void SampleColumn::flushTail() {
+    m_chunks.append(m_store->write(m_tail.constData()));
+    m_tail.clear();
+}
+
+void SampleColumn::clearPaged() {
+    m_chunks.clear();
+    m_tail.clear();
+    m_start = 0;
+    m_size = 0;
+}
+
+void SampleColumn::append(RawSample v) {
+    if (!isPaged()) {
+        m_data.append(v);
+        return;
+    }
+    m_tail.append(v);
+    ++m_size;
+    if (m_tail.size() == kChunk) flushTail();
+}
+
+void SampleColumn::append(const RawSample *data, qsizetype count) {
+    if (count <= 0) return;
+    if (!isPaged()) {
+        const qsizetype old = m_data.size();
+        m_data.resize(old + count);
+        std::copy(data, data + count, m_data.data() + old);
+        return;
+    }
+
+    while (count > 0) {
+        const qsizetype old = m_tail.size();
+        const qsizetype take = std::min(count, kChunk - old);
+        m_tail.resize(old + take);
+        std::copy(data, data + take, m_tail.data() + old);
+        data += take;
+        count -= take;
+        m_size += take;
+        if (m_tail.size() == kChunk) flushTail();
+    }
+}
+
+void SampleColumn::append(const SampleColumn &other, qsizetype from, qsizetype count) {
+    if (!isPaged() && !other.isPaged() && from == 0 && count == other.size()) {
+        m_data.append(other.m_data);
+        return;
+    }
+    other.forEachSpan(from, from + count, [this](const RawSample *data, qsizetype, qsizetype n) { append(data, n); });
+}
+
+void SampleColumn::resize(qsizetype n, RawSample fill) {
+    if (n <= size()) {
+        truncate(n);
+        return;
+    }
+    if (!isPaged()) {
+        m_data.resize(n, fill);
+        return;
+    }
+    const QVector<RawSample> filler(std::min(n - m_size, kChunk), fill);
+    while (m_size < n) append(filler.constData(), std::min(n - m_size, filler.size()));
+}
+
+void SampleColumn::truncate(qsizetype n) {
+    if (!isPaged()) {
+        if (n < m_data.size()) m_data.resize(std::max<qsizetype>(n, 0));
+        return;
+    }
+    if (n >= m_size) return;
+    if (n <= 0) {
+        clearPaged();
+        return;
+    }
+
+    // Новый конец внутри записанного куска: его начало снова становится хвостом в памяти
+    const qsizetype end = m_start + n;
+    const qsizetype tailStart = m_chunks.size() * kChunk;
+    if (end < tailStart) {
+        const qsizetype c = end / kChunk;
+        const ChunkStore::Chunk chunk = m_store->read(m_chunks.at(c));
+        const RawSample *base = chunk ? chunk->constData() : gapChunk();
+        m_tail = QVector<RawSample>(base, base + (end - c * kChunk));
+        m_chunks.resize(c);
+    } else {
+        m_tail.resize(end - tailStart);
+    }
+    m_size = n;
+}
+
+void SampleColumn::removeFirst(qsizetype n) {
+    if (n <= 0) return;
+    if (!isPaged()) {
+        m_data.remove(0, std::min(n, m_data.size()));
+        return;
+    }
+    if (n >= m_size) {
+        clearPaged();
+        return;
+    }
+
+    // Место в файле не освобождается, из колонки уходят только ссылки на куски
+    m_start += n;
+    m_size -= n;
+    while (m_start >= kChunk && !m_chunks.isEmpty()) {
+        m_chunks.removeFirst();
+        m_start -= kChunk;
+    }
+}
+
+void SampleColumn::squeeze() {
+    if (isPaged()) m_tail.squeeze();
+    else m_data.squeeze();
+}
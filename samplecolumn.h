@@ -0,0 +1,113 @@
+#ifndef SAMPLECOLUMN_H
+#define SAMPLECOLUMN_H
+
+#include <QSharedPointer>
+#include <QVector>
+
+#include <algorithm>
+
+#include "rawsample.h"
+#include "chunkstore.h"
+
+// Колонка сырых отсчетов канала.
+// Обычно это просто QVector в памяти. Для наборов больше лимита памяти колонка
+// хранится в ChunkStore: полные куски лежат на диске, в памяти - только
+// недописанный последний кусок, остальные читаются через LRU-кэш хранилища.
+//
+// Читать можно одинаково в обоих режимах: operator[] - для отдельных отсчетов,
+// forEachSpan и Cursor - для проходов (в памяти это просто указатель).
+// Запись по индексу (set, constData) - только в памяти (разбор), дописывание
+// и обрезка с краев - в обоих режимах.
+class SampleColumn
+{
+public:
+    SampleColumn() = default;
+    explicit SampleColumn(const QSharedPointer<ChunkStore> &store) : m_store(store) {}
+
+    bool isPaged() const { return !m_store.isNull(); }
+    qsizetype size() const { return isPaged() ? m_size : m_data.size(); }
+    bool isEmpty() const { return size() == 0; }
+
+    RawSample operator[](qsizetype i) const { return isPaged() ? pagedAt(i) : m_data.constData()[i]; }
+
+    // Непрерывные куски отсчетов [from, to) по порядку:
+    // fn(const RawSample *data, qsizetype first, qsizetype count), data[0] - отсчет first
+    template <typename Fn>
+    void forEachSpan(qsizetype from, qsizetype to, Fn fn) const;
+
+    // Чтение по возрастанию индексов (экспорт): держит текущий кусок колонки
+    class Cursor
+    {
+    public:
+        Cursor() = default;
+        explicit Cursor(const SampleColumn &column) : m_column(&column) {}
+
+        RawSample operator[](qsizetype i) {
+            const qsizetype k = i - m_first;
+            if (k >= 0 && k < m_count) return m_data[k];
+            return load(i);
+        }
+
+    private:
+        RawSample load(qsizetype i);
+
+        const SampleColumn *m_column = nullptr;
+        ChunkStore::Chunk m_chunk;
+        const RawSample *m_data = nullptr;
+        qsizetype m_first = 0;
+        qsizetype m_count = 0;
+    };
+
+    // Только для колонок в памяти
+    const RawSample *constData() const;
+    void set(qsizetype i, RawSample v) { m_data[i] = v; }
+    void reserve(qsizetype n) {
+        if (!isPaged()) m_data.reserve(n);
+    }
+
+    void append(RawSample v);
+    void append(const RawSample *data, qsizetype count);
+    void append(const SampleColumn &other) { append(other, 0, other.size()); }
+    void append(const SampleColumn &other, qsizetype from, qsizetype count);
+    // Рост - значениями fill, уменьшение - как truncate
+    void resize(qsizetype n, RawSample fill = gapSample());
+    void truncate(qsizetype n);
+    void removeFirst(qsizetype n);
+    void squeeze();
+
+private:
+    RawSample pagedAt(qsizetype i) const;
+    // Непрерывный кусок, содержащий отсчет i: отсчеты [first, first + count),
+    // возвращает указатель на отсчет first; hold держит кусок из кэша
+    const RawSample *span(qsizetype i, qsizetype &first, qsizetype &count, ChunkStore::Chunk &hold) const;
+    void flushTail();
+    void clearPaged();
+
+    QVector<RawSample> m_data; // колонка в памяти
+
+    // Колонка на диске: логический отсчет i - физический m_start + i,
+    // физический p лежит в куске m_chunks[p / kChunkSamples] или в m_tail
+    QSharedPointer<ChunkStore> m_store;
+    QVector<qint64> m_chunks;
+    QVector<RawSample> m_tail;
+    qsizetype m_start = 0;
+    qsizetype m_size = 0;
+};
+
+template <typename Fn>
+void SampleColumn::forEachSpan(qsizetype from, qsizetype to, Fn fn) const {
+    if (!isPaged()) {
+        if (from < to) fn(m_data.constData() + from, from, to - from);
+        return;
+    }
+    ChunkStore::Chunk hold;
+    for (qsizetype i = from; i < to;) {
+        qsizetype first = 0, count = 0;
+        const RawSample *data = span(i, first, count, hold);
+        const qsizetype end = std::min(to, first + count);
+        fn(data + (i - first), i, end - i);
+        i = end;
+    }
+}
+
+#endif // SAMPLECOLUMN_H
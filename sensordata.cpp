@@ -0,0 +1,257 @@
+#include "sensordata.h"
+#include "calibration.h"
+
+#include <QtMath>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Строка с данными - та, где есть отсчет хотя бы одного канала. Курсоры держат
+// текущие чанки обоих каналов: обход подряд (в т.ч. назад) не идет в ChunkStore на каждую строку
+class RowProbe
+{
+public:
+    explicit RowProbe(const Sensor &s) : m_a(s.rawA), m_b(s.rawB) {}
+    bool hasSample(qsizetype i) { return !isGap(m_a[i]) || !isGap(m_b[i]); }
+
+private:
+    SampleColumn::Cursor m_a;
+    SampleColumn::Cursor m_b;
+};
+
+// Число строк колонки без строк-пропусков в конце
+qsizetype trimmedSize(const Sensor &s) {
+    RowProbe probe(s);
+    qsizetype n = s.size();
+    while (n > 0 && !probe.hasSample(n - 1)) --n;
+    return n;
+}
+
+Sensor *findSensor(QVector<Sensor> &sensors, int id) {
+    for (Sensor &s : sensors) {
+        if (s.id == id) return &s;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+double SensorDataset::safeDivide(double target, double current) {
+    return (qAbs(current) > 1e-6) ? (target / current) : 1.0;
+}
+
+void SensorDataset::computeStats() {
+    CalibrationEngine::computeStats(*this);
+}
+
+void SensorDataset::computeDrift() {
+    CalibrationEngine::computeDrift(*this);
+}
+
+void SensorDataset::sampleRange(const Sensor &s, double tFrom, double tTo, qsizetype &from, qsizetype &to,
+                                bool widen) const {
+    const double *t = time.constData() + s.offset;
+    const double *end = t + s.size();
+    from = std::lower_bound(t, end, tFrom) - t;
+    to = std::upper_bound(t + from, end, tTo) - t;
+
+    // По точке за краями окна, чтобы линия не обрывалась на границе
+    if (!widen) return;
+    if (from > 0) --from;
+    if (to < s.size()) ++to;
+}
+
+WindowStats SensorDataset::windowStats(const Sensor &s, int channel, double tFrom, double tTo) const {
+    qsizetype from = 0, to = 0;
+    sampleRange(s, tFrom, tTo, from, to, false);
+    if (channel == 0) return s.aggA.query(s.rawA, s.lodA, from, to);
+    return s.aggB.query(s.rawB, s.lodB, from, to);
+}
+
+void SensorDataset::chartPoints(const Sensor &s, int channel, bool corrected, qsizetype from, qsizetype to,
+                                int maxBuckets, QList<QPointF> &points) const {
+    const bool isA = (channel == 0);
+    const SampleColumn &raw = isA ? s.rawA : s.rawB;
+    const LodPyramid &lod = isA ? s.lodA : s.lodB;
+    const double *t = time.constData() + s.offset;
+
+    QVector<qsizetype> indices;
+    lod.decimate(raw, from, to, maxBuckets, indices);
+
+    points.clear();
+    points.reserve(indices.size());
+    for (qsizetype i : std::as_const(indices)) {
+        const double k = corrected ? coefficient(s, channel, i) : 1.0;
+        points.append(QPointF(t[i], raw[i] * k));
+    }
+}
+
+void SensorDataset::buildGrid(double step, qsizetype rowFrom, qsizetype rowTo, TimeGrid &grid) const {
+    grid = TimeGrid();
+    grid.step = step;
+    if (!(step > 0.0) || rowFrom >= rowTo) return;
+
+    // Время по возрастанию - номера узлов тоже, новый узел начинается со смены номера
+    const double start = std::floor(time[rowFrom] / step) * step;
+    qint64 current = -1;
+    for (qsizetype r = rowFrom; r < rowTo; ++r) {
+        const qint64 node = qint64(std::floor((time[r] - start) / step));
+        if (node == current) continue;
+        current = node;
+        grid.times.append(start + double(node) * step);
+        grid.rows.append(r);
+    }
+    grid.rows.append(rowTo);
+}
+
+bool SensorDataset::gridSample(const Sensor &s, qsizetype rowFrom, qsizetype rowTo, SampleColumn::Cursor &rawA,
+                               SampleColumn::Cursor &rawB, GridSample &out) const {
+    const qsizetype from = std::max<qsizetype>(rowFrom - s.offset, 0);
+    const qsizetype to = std::min(rowTo - s.offset, s.size());
+    GridSample sum;
+    qsizetype count = 0;
+    for (qsizetype i = from; i < to; ++i) {
+        const RawSample a = rawA[i];
+        if (isGap(a)) continue;
+        const RawSample b = rawB[i];
+        sum.rawA += a;
+        sum.rawB += b;
+        sum.corrA += a * coefficient(s, 0, i);
+        sum.corrB += b * coefficient(s, 1, i);
+        ++count;
+    }
+    if (count == 0) return false;
+    out.rawA = sum.rawA / count;
+    out.rawB = sum.rawB / count;
+    out.corrA = sum.corrA / count;
+    out.corrB = sum.corrB / count;
+    return true;
+}
+
+void SensorDataset::buildLod() {
+    QtConcurrent::blockingMap(sensors, [](Sensor &s) {
+        s.lodA.build(s.rawA, s.size());
+        s.lodB.build(s.rawB, s.size());
+    });
+}
+
+void SensorDataset::buildAggregates() {
+    // Сдвиг на среднее канала: статистики уже посчитаны
+    QtConcurrent::blockingMap(sensors, [](Sensor &s) {
+        s.aggA.build(s.rawA, s.size(), s.statsA.mean());
+        s.aggB.build(s.rawB, s.size(), s.statsB.mean());
+    });
+}
+
+void SensorDataset::calculateRanges() {
+    if (sensors.isEmpty()) return;
+    double tMin = std::numeric_limits<double>::max();
+    double tMax = std::numeric_limits<double>::lowest();
+    double vMin = std::numeric_limits<double>::max();
+    double vMax = std::numeric_limits<double>::lowest();
+
+    for (const Sensor &s : sensors) {
+        tMin = std::min(tMin, s.statsTime.min);
+        tMax = std::max(tMax, s.statsTime.max);
+        vMin = std::min({vMin, s.statsA.min, s.statsB.min});
+        vMax = std::max({vMax, s.statsA.max, s.statsB.max});
+    }
+    double padding = (vMax - vMin) * 0.05;
+    if (padding == 0) padding = 1.0;
+    minTime = tMin;
+    maxTime = tMax;
+    minValue = vMin - padding;
+    maxValue = vMax + padding;
+}
+
+void SensorDataset::preCalculateCalibration() {
+    // Флаги нужны калибровке раньше эталона (anomaly.excludeFromReference)
+    AnomalyDetector::classify(*this);
+    CalibrationEngine::calibrate(*this);
+    CalibrationEngine::calibrateRolling(*this);
+}
+
+bool SensorDataset::hasNewSensors(const SensorDataset &tail) const {
+    for (const Sensor &t : tail.sensors) {
+        if (trimmedSize(t) == 0) continue;
+        const bool known = std::any_of(sensors.cbegin(), sensors.cend(), [&t](const Sensor &s) { return s.id == t.id; });
+        if (!known) return true;
+    }
+    return false;
+}
+
+void SensorDataset::appendRows(const SensorDataset &tail) {
+    const qsizetype baseRow = time.size();
+    time.append(tail.time);
+
+    bool added = false;
+    for (const Sensor &t : tail.sensors) {
+        const qsizetype last = trimmedSize(t);
+        if (last == 0) continue;
+
+        Sensor *s = findSensor(sensors, t.id);
+        qsizetype first = 0;
+        if (!s) {
+            // Датчик впервые дал данные: колонка начинается с его первого отсчета
+            RowProbe probe(t);
+            while (!probe.hasSample(first)) ++first;
+            Sensor fresh;
+            fresh.id = t.id;
+            fresh.name = t.name;
+            fresh.offset = baseRow + first;
+            if (store) {
+                fresh.rawA = SampleColumn(store);
+                fresh.rawB = SampleColumn(store);
+            }
+            sensors.append(fresh);
+            s = &sensors.last();
+            added = true;
+        }
+
+        // Строки между прежним концом датчика и хвостом - пропуски
+        const qsizetype oldSize = s->size();
+        const qsizetype start = baseRow + first - s->offset;
+        const qsizetype newSize = start + (last - first);
+        s->rawA.resize(start, gapSample());
+        s->rawB.resize(start, gapSample());
+        s->rawA.append(t.rawA, first, last - first);
+        s->rawB.append(t.rawB, first, last - first);
+
+        const qsizetype n = newSize - oldSize;
+        s->statsA.merge(CalibrationEngine::columnStats(s->rawA, oldSize, newSize));
+        s->statsB.merge(CalibrationEngine::columnStats(s->rawB, oldSize, newSize));
+        s->statsTime.merge(CalibrationEngine::columnStats(time.constData() + s->offset + oldSize, n));
+        // Строки тиков, где датчик молчал весь хвост (continue выше), мониторы не видели -
+        // это тоже пропуски. Строки прошлого хвоста после его последней строки с данными
+        // уже в pendingGaps обоих каналов, пропуски в начале этого хвоста - в leadingGaps
+        const qint64 seen = std::min(s->monitorA.pendingGaps, s->monitorB.pendingGaps);
+        const qint64 unseen = (start - oldSize) - seen;
+        if (oldSize > 0 && unseen > 0) {
+            s->monitorA.addGaps(unseen);
+            s->monitorB.addGaps(unseen);
+        }
+        s->monitorA.merge(t.monitorA);
+        s->monitorB.merge(t.monitorB);
+        s->lodA.extend(s->rawA, oldSize, newSize);
+        s->lodB.extend(s->rawB, oldSize, newSize);
+        if (oldSize == 0) {
+            s->aggA.build(s->rawA, newSize, s->statsA.mean());
+            s->aggB.build(s->rawB, newSize, s->statsB.mean());
+        } else {
+            s->aggA.extend(s->rawA, oldSize, newSize);
+            s->aggB.extend(s->rawB, oldSize, newSize);
+        }
+    }
+
+    if (added) {
+        std::sort(sensors.begin(), sensors.end(), [](const Sensor &a, const Sensor &b) { return a.id < b.id; });
+    }
+    // Скользящая калибровка: пересчитываются только корзины новых строк
+    if (rolling.window > 0.0) CalibrationEngine::computeDrift(*this, baseRow);
+    preCalculateCalibration();
+    calculateRanges();
+}
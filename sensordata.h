@@ -0,0 +1,201 @@
+#ifndef SENSORDATA_H
+#define SENSORDATA_H
+
+#include <QVector>
+#include <QList>
+#include <QPointF>
+#include <QString>
+
+#include <algorithm>
+#include <limits>
+
+#include "rawsample.h"
+#include "samplecolumn.h"
+#include "lodpyramid.h"
+#include "aggregates.h"
+#include "anomalydetector.h"
+
+// Агрегаты канала по всем отсчетам без пропусков. Считаются одним проходом
+// (CalibrationEngine::computeStats) и дальше переиспользуются калибровкой,
+// диапазонами и статистикой, так что повторно по данным никто не ходит.
+struct ChannelStats {
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    qsizetype count = 0;
+
+    double mean() const { return (count > 0) ? sum / count : 0.0; }
+
+    // Агрегаты дописанного хвоста колонки
+    void merge(const ChannelStats &other) {
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        count += other.count;
+    }
+};
+
+// Скользящая калибровка для долгих прогонов, где датчики дрейфуют. Ось времени
+// режется на корзины по step() = window / kSpan секунд; коэффициент корзины j
+// считается по окну из kSpan соседних корзин с центром в j (скользящие суммы)
+// против опорного значения того же окна. Между центрами корзин коэффициент
+// интерполируется линейно, за крайними центрами - крайнее значение.
+struct RollingCalibration {
+    static constexpr int kSpan = 5;
+    static constexpr qsizetype kMaxBins = 100000;
+
+    double window = 0.0;       // длина окна, с; 0 - один коэффициент на весь набор
+    double start = 0.0;        // начало первой корзины (первая строка набора)
+    QVector<double> reference; // опорное значение по корзинам (как globalReference)
+
+    bool isActive() const { return window > 0.0 && !reference.isEmpty(); }
+    double step() const { return window / kSpan; }
+    double centerTime(qsizetype bin) const { return start + (bin + 0.5) * step(); }
+
+    // Значение ряда по корзинам в момент t; fallback - если ряд пустой
+    double interpolate(const QVector<double> &values, double t, double fallback) const {
+        if (values.isEmpty()) return fallback;
+        const double u = (t - start) / step() - 0.5;
+        if (!(u > 0.0)) return values.first();
+        const qsizetype j = qsizetype(u);
+        if (j >= values.size() - 1) return values.last();
+        return values[j] + (values[j + 1] - values[j]) * (u - double(j));
+    }
+};
+
+// Канал в скользящей калибровке: агрегаты по корзинам и коэффициенты в их центрах
+struct ChannelDrift {
+    QVector<ChannelStats> bins;
+    QVector<double> k; // пусто - корзин с данными нет, действует kA/kB
+};
+
+// Колоночное хранение: у датчика только сырые каналы A/B, время общее для набора
+// (SensorDataset::time). Отсчет i датчика соответствует строке offset + i.
+// Скорректированные значения не хранятся: raw * k считается при чтении
+// (SensorDataset::coefficient).
+// Каналы - в памяти или (большие наборы) кусками на диске, см. SampleColumn.
+struct Sensor {
+    int id;
+    QString name;
+    qsizetype offset = 0;
+    SampleColumn rawA;
+    SampleColumn rawB;
+    double kA = 1.0;
+    double kB = 1.0;
+
+    ChannelStats statsA;
+    ChannelStats statsB;
+    ChannelStats statsTime; // min/max времени по строкам датчика (sum не используется)
+
+    // Пирамиды min/max для графика
+    LodPyramid lodA;
+    LodPyramid lodB;
+
+    // Префиксные суммы для статистики по окну времени
+    ChannelAggregates aggA;
+    ChannelAggregates aggB;
+
+    // Скользящая калибровка (SensorDataset::rolling)
+    ChannelDrift driftA;
+    ChannelDrift driftB;
+
+    // Потоковые детекторы неисправностей (заполняются при разборе) и их флаги
+    ChannelMonitor monitorA;
+    ChannelMonitor monitorB;
+    quint32 anomalies = 0; // AnomalyFlag, AnomalyDetector::classify
+
+    qsizetype size() const { return rawA.size(); }
+    bool isEmpty() const { return rawA.isEmpty(); }
+};
+
+// Сетка с постоянным шагом поверх общей оси времени (выгрузка с передискретизацией).
+// Узел e - интервал [times[e], times[e] + step), ему соответствуют строки
+// [rows[e], rows[e + 1]). Хранятся только узлы, где есть строки, поэтому мелкий
+// шаг на редких данных не раздувает сетку.
+struct TimeGrid {
+    double step = 0.0;
+    QVector<double> times;
+    QVector<qsizetype> rows; // границы узлов, на одну больше, чем times
+
+    qsizetype size() const { return times.size(); }
+};
+
+// Средние каналов датчика на узле сетки
+struct GridSample {
+    double rawA = 0.0;
+    double rawB = 0.0;
+    double corrA = 0.0;
+    double corrB = 0.0;
+};
+
+// Загруженный набор данных вместе с посчитанной калибровкой и диапазонами.
+// Собирается целиком в рабочем потоке и отдается модели одним присваиванием.
+struct SensorDataset {
+    QVector<double> time; // общая ось времени: одна запись на строку файла
+    QVector<Sensor> sensors;
+    // Хранилище колонок на диске (набор больше лимита памяти); nullptr - все в памяти.
+    // Ось времени, агрегаты и пирамиды всегда в памяти.
+    QSharedPointer<ChunkStore> store;
+    double globalReference = 0.0;
+    double avgDeviation = 0.0; // среднее |1 - k| по всем каналам, считается калибровкой
+    RollingCalibration rolling;
+    AnomalyOptions anomaly;
+    double minTime = 0.0;
+    double maxTime = 10.0;
+    double minValue = 0.0;
+    double maxValue = 100.0;
+
+    double timeAt(const Sensor &s, qsizetype i) const { return time[s.offset + i]; }
+
+    // Хранилище не смогло прочитать или записать кусок: вместо него колонки отдали пропуски,
+    // так что посчитанное или выгруженное по набору неверно
+    bool storageFailed() const { return store && store->hasError(); }
+
+    // Коэффициент канала (0 = A, 1 = B) для отсчета i: kA/kB или по скользящей калибровке
+    double coefficient(const Sensor &s, int channel, qsizetype i) const {
+        const double k = (channel == 0) ? s.kA : s.kB;
+        if (!rolling.isActive()) return k;
+        return rolling.interpolate((channel == 0) ? s.driftA.k : s.driftB.k, timeAt(s, i), k);
+    }
+
+    // Отсчеты датчика [from, to), попадающие в окно [tFrom, tTo], плюс (widen) по одному
+    // за краями окна. Бинарный поиск: время в файле идет по возрастанию.
+    void sampleRange(const Sensor &s, double tFrom, double tTo, qsizetype &from, qsizetype &to,
+                     bool widen = true) const;
+
+    // Среднее, СКО, min/max сырого канала (0 = A, 1 = B) на окне [tFrom, tTo]
+    WindowStats windowStats(const Sensor &s, int channel, double tFrom, double tTo) const;
+
+    // Точки графика канала для отсчетов [from, to): не больше ~2 на корзину (min и max)
+    void chartPoints(const Sensor &s, int channel, bool corrected, qsizetype from, qsizetype to, int maxBuckets,
+                     QList<QPointF> &points) const;
+
+    // Сетка с шагом step по строкам [rowFrom, rowTo) - один проход по time;
+    // узлы выровнены на кратные step (ровные метки времени)
+    void buildGrid(double step, qsizetype rowFrom, qsizetype rowTo, TimeGrid &grid) const;
+    // Средние датчика по строкам узла [rowFrom, rowTo); узлы - по возрастанию, курсоры
+    // датчика переходят от узла к узлу. false - в узле нет отсчетов датчика.
+    bool gridSample(const Sensor &s, qsizetype rowFrom, qsizetype rowTo, SampleColumn::Cursor &rawA,
+                    SampleColumn::Cursor &rawB, GridSample &out) const;
+
+    // computeStats - единственный проход по отсчетам; калибровка и диапазоны
+    // дальше считаются по агрегатам за O(число датчиков)
+    void computeStats();
+    // Агрегаты корзин скользящей калибровки (rolling.window > 0) - еще один проход по отсчетам
+    void computeDrift();
+    void buildLod();
+    void buildAggregates();
+    void preCalculateCalibration();
+    void calculateRanges();
+
+    // Слежение за файлом: tail - новые строки в виде плотных колонок по слотам
+    // (как после TxtParser::parseRows). Статистика и пирамиды досчитываются
+    // только по новым отсчетам, калибровка и диапазоны - по агрегатам.
+    void appendRows(const SensorDataset &tail);
+    // Есть ли в tail данные датчиков, которых еще нет в наборе
+    bool hasNewSensors(const SensorDataset &tail) const;
+
+    static double safeDivide(double target, double current);
+};
+
+#endif // SENSORDATA_H
@@ -1,34 +1,55 @@
 #include "sensormodel.h"
 
 #include <QFile>
-#include <QTextStream>
-#include <QRegularExpression>
 #include <QDebug>
 #include <QUrl>
-#include <QStandardPaths>
-#include <QDir>
 #include <QtMath>
 #include <QFileInfo>
-#include <QDateTime>
-#include <QCoreApplication>
+#include <QSharedPointer>
+#include <QSettings>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "datasetloader.h"
+#include "csvexporter.h"
+#include "jsonexporter.h"
+#include "columnexporter.h"
+#include "tracer.h"
+
+SensorModel::SensorModel(QObject *parent) : QAbstractListModel(parent) {
+    connect(&m_taskWatcher, &QFutureWatcher<bool>::finished, this, &SensorModel::onTaskFinished);
+
+    // Прогресс читаем по таймеру, а не сигналом из рабочего потока на каждую строку
+    m_progressTimer.setInterval(100);
+    connect(&m_progressTimer, &QTimer::timeout, this, &SensorModel::updateProgress);
+
+    // Слежение за файлом: сколько бы строк ни пришло, обновление одно за тик
+    m_followTimer.setInterval(kFollowRefreshMs);
+    connect(&m_followTimer, &QTimer::timeout, this, &SensorModel::onFollowTick);
+    connect(&m_followWatcher, &QFutureWatcher<void>::finished, this, &SensorModel::onFollowReadFinished);
+}
 
-SensorModel::SensorModel(QObject *parent) : QAbstractListModel(parent) {}
+SensorModel::~SensorModel() {
+    // Задача держит ссылку на m_control - дожидаемся ее
+    m_control.cancel();
+    m_taskWatcher.waitForFinished();
+}
 
 int SensorModel::rowCount(const QModelIndex &parent) const {
     if (parent.isValid()) return 0;
-    return m_sensors.size();
+    return m_dataset.sensors.size();
 }
 
 QVariant SensorModel::data(const QModelIndex &index, int role) const {
     if (!index.isValid()) return {};
     int row = index.row();
-    if (row < 0 || row >= m_sensors.size()) return {};
+    if (row < 0 || row >= m_dataset.sensors.size()) return {};
 
-    const Sensor &s = m_sensors.at(row);
+    const Sensor &s = m_dataset.sensors.at(row);
     switch (role) {
     case IdRole: return s.id;
     case NameRole: return s.name;
     case DataRole: return sensorDataToVariantList(s);
+    case AnomaliesRole: return AnomalyDetector::describe(s.anomalies).join(", ");
     default: return {};
     }
 }
@@ -38,6 +59,7 @@ QHash<int, QByteArray> SensorModel::roleNames() const {
     roles[IdRole] = "sensorId";
     roles[NameRole] = "sensorName";
     roles[DataRole] = "sensorData";
+    roles[AnomaliesRole] = "sensorAnomalies";
     return roles;
 }
 
@@ -45,436 +67,593 @@ QVariant SensorModel::sensorDataToVariantList(const Sensor &s) const {
     return QVariantList(); // Оптимизация: данные не гоняем через модель в QML
 }
 
-
-
-void SensorModel::exportToJson(const QString &fileUrl) {
+QString SensorModel::toLocalPath(const QString &fileUrl, const QString &suffix) {
     QString path = QUrl(fileUrl).toLocalFile();
     if (path.isEmpty()) path = fileUrl;
-    if (!path.endsWith(".json", Qt::CaseInsensitive)) path += ".json";
-
-    // 1. Статистика
-    double totalDev = 0;
-    int count = 0;
-    for(const Sensor &s : m_sensors) {
-        totalDev += qAbs(1.0 - s.kA) + qAbs(1.0 - s.kB);
-        count += 2;
-    }
-    double avgDevPercent = (count > 0) ? (totalDev / count) * 100.0 : 0.0;
-
-    QJsonObject statsObj;
-    statsObj["global_reference_value"] = m_globalReference;
-    statsObj["average_system_deviation_percent"] = QString::number(avgDevPercent, 'f', 2).toDouble();
-    statsObj["total_sensors_count"] = m_sensors.size();
-
-    // 2. Сенсоры
-    QJsonArray sensorsArr;
-    for (const Sensor &s : m_sensors) {
-        QJsonObject sObj;
-        sObj["id"] = s.id;
-        sObj["name"] = s.name;
-
-        QJsonObject calibObj;
-        calibObj["coeff_A"] = s.kA;
-        calibObj["coeff_B"] = s.kB;
-        calibObj["error_A_percent"] = QString::number((s.kA - 1.0) * 100.0, 'f', 2).toDouble();
-        calibObj["error_B_percent"] = QString::number((s.kB - 1.0) * 100.0, 'f', 2).toDouble();
-        sObj["calibration"] = calibObj;
-
-        QJsonArray dataArr;
-        for (const DataPoint &dp : s.data) {
-            QJsonObject p;
-            p["t"] = QString::number(dp.time, 'f', 3).toDouble();
-            p["raw_A"] = dp.v1;
-            p["raw_B"] = dp.v2;
-            p["corr_A"] = QString::number(dp.v1_corr, 'f', 2).toDouble();
-            p["corr_B"] = QString::number(dp.v2_corr, 'f', 2).toDouble();
-            dataArr.append(p);
-        }
-        sObj["data"] = dataArr;
-        sensorsArr.append(sObj);
-    }
+    if (!suffix.isEmpty() && !path.endsWith(suffix, Qt::CaseInsensitive)) path += suffix;
+    return path;
+}
 
-    QJsonObject root;
-    root["meta_info"] = QJsonObject{
-        {"exported_at", QDateTime::currentDateTime().toString(Qt::ISODate)},
-        {"app_name", "SolarSensors Analytics"}
-    };
-    root["statistics"] = statsObj;
-    root["sensors"] = sensorsArr;
-
-    QFile file(path);
-    if (file.open(QIODevice::WriteOnly)) {
-        QJsonDocument doc(root);
-        file.write(doc.toJson(QJsonDocument::Indented));
-        file.close();
-        qInfo() << "Exported JSON to:" << path;
-    } else {
-        qWarning() << "Failed to save JSON:" << path;
-    }
+CsvExporter::Options SensorModel::toCsvOptions(const QVariantMap &map) {
+    CsvExporter::Options options;
+    options.raw = map.value("raw", true).toBool();
+    options.corrected = map.value("corrected", true).toBool();
+    for (const QVariant &id : map.value("sensors").toList()) options.sensorIds.append(id.toInt());
+    if (map.contains("tFrom")) options.tFrom = map.value("tFrom").toDouble();
+    if (map.contains("tTo")) options.tTo = map.value("tTo").toDouble();
+    options.step = map.value("step", 0.0).toDouble();
+    return options;
+}
+
+void SensorModel::setDataset(SensorDataset &&dataset) {
+    beginResetModel();
+    m_dataset = std::move(dataset);
+    ++m_dataRevision;
+    ++m_samplesRevision;
+    endResetModel();
+    // Матрица другого набора не нужна даже как устаревшая
+    m_correlation.setMatrix(CorrelationMatrix());
+    emit correlationChanged();
+    emit dataRangeChanged();
+    emit datasetReplaced();
 }
 
 // ---------------------------------------------------------
-// Конвертация TXT -> JSON
+// Синхронные операции
 // ---------------------------------------------------------
-bool SensorModel::convertTxtToJson(const QString &txtFilePath, const QString &jsonFilePath) {
-    QFile file(txtFilePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
-
-    QTextStream in(&file);
-    QString headerLine;
-    bool headerFound = false;
-
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        if (line.contains("Time", Qt::CaseInsensitive) && line.contains("_A", Qt::CaseInsensitive)) {
-            headerLine = line;
-            headerFound = true;
-            break;
-        }
-    }
-    if (!headerFound) return false;
+void SensorModel::exportToJson(const QString &fileUrl, bool compact) {
+    JsonExporter::write(m_dataset, toLocalPath(fileUrl, ".json"), nullptr,
+                        compact ? JsonExporter::Format::Compact : JsonExporter::Format::Indented);
+    emit traceChanged();
+}
 
-    QStringList headers = headerLine.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
-    struct ColInfo { int sensorId; QString type; };
-    QMap<int, ColInfo> colMap;
-    QRegularExpression re("S(\\d+)_([AB])", QRegularExpression::CaseInsensitiveOption);
+void SensorModel::exportToCsv(const QString &fileUrl) {
+    CsvExporter::write(m_dataset, toLocalPath(fileUrl, ".csv"));
+    emit traceChanged();
+}
 
-    for (int i = 0; i < headers.size(); ++i) {
-        QRegularExpressionMatch match = re.match(headers[i].trimmed());
-        if (match.hasMatch()) {
-            colMap[i] = { match.captured(1).toInt(), match.captured(2).toUpper() };
-        }
+void SensorModel::importFromTxt(const QString &fileUrl) {
+    // Фоновая задача по окончании сама заменит набор (импорт) или вернет его пересчитанную
+    // копию (калибровка) - синхронная загрузка посреди нее потерялась бы или затерла бы ее
+    if (m_busy) {
+        qWarning() << "Import rejected, operation running:" << m_operation;
+        return;
     }
+    const QString txtPath = toLocalPath(fileUrl);
+
+    SensorDataset dataset;
+    const bool ok = DatasetLoader::load(txtPath, dataset, nullptr, loadOptions());
+    emit traceChanged();
+    if (!ok) return;
+    stopFollowing();
+    setDataset(std::move(dataset));
+    addRecentDataset(txtPath);
+}
 
-    QMap<int, QJsonArray> sensorDataArrays;
-    while (!in.atEnd()) {
-        QString line = in.readLine().trimmed();
-        if (line.isEmpty()) continue;
-        line.replace(',', '.');
-        QStringList parts = line.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
-        if (parts.size() < 2) continue;
-
-        double time = parts[0].toDouble();
-        QMap<int, QJsonObject> rowPoints;
-
-        for (int i = 1; i < parts.size(); ++i) {
-            if (!colMap.contains(i)) continue;
-            ColInfo info = colMap[i];
-            double val = parts[i].toDouble();
-            if (!rowPoints.contains(info.sensorId)) {
-                QJsonObject p; p["t"] = time; p["v1"] = 0.0; p["v2"] = 0.0;
-                rowPoints[info.sensorId] = p;
-            }
-            if (info.type == "A") rowPoints[info.sensorId]["v1"] = val;
-            else rowPoints[info.sensorId]["v2"] = val;
-        }
-        auto it = rowPoints.constBegin();
-        while (it != rowPoints.constEnd()) {
-            sensorDataArrays[it.key()].append(it.value());
-            ++it;
-        }
-    }
-    file.close();
-
-    QJsonArray sensorsArray;
-    auto it = sensorDataArrays.constBegin();
-    while (it != sensorDataArrays.constEnd()) {
-        QJsonObject sensorObj;
-        sensorObj["id"] = it.key();
-        sensorObj["name"] = QString("Sensor %1").arg(it.key());
-        sensorObj["data"] = it.value();
-        sensorsArray.append(sensorObj);
-        ++it;
-    }
+bool SensorModel::loadResultsFile(const QString &filePath) {
+    if (!QFile::exists(filePath)) return false;
+    const quint64 revision = m_dataRevision;
+    importFromTxt(filePath);
+    return m_dataRevision != revision && !m_dataset.sensors.isEmpty();
+}
 
-    QJsonObject root;
-    root["sensors"] = sensorsArray;
+// ---------------------------------------------------------
+// Недавние наборы данных
+// ---------------------------------------------------------
+QStringList SensorModel::recentDatasets() const {
+    return QSettings().value(kRecentKey).toStringList();
+}
 
-    QFile jsonFile(jsonFilePath);
-    if (!jsonFile.open(QIODevice::WriteOnly)) return false;
-    QJsonDocument doc(root);
-    jsonFile.write(doc.toJson(QJsonDocument::Indented));
-    jsonFile.close();
-    return true;
+void SensorModel::addRecentDataset(const QString &txtPath) {
+    const QString path = QFileInfo(txtPath).absoluteFilePath();
+    QStringList recent = recentDatasets();
+    recent.removeAll(path);
+    recent.prepend(path);
+    while (recent.size() > kMaxRecent) recent.removeLast();
+    QSettings().setValue(kRecentKey, recent);
+    emit recentDatasetsChanged();
 }
 
-bool SensorModel::parseJsonInternal(const QString &jsonFilePath) {
-    QFile file(jsonFilePath);
-    if (!file.open(QIODevice::ReadOnly)) return false;
-    QByteArray jsonData = file.readAll();
-    file.close();
+int SensorModel::memoryLimitMb() const {
+    return QSettings().value(kMemoryLimitKey, 0).toInt();
+}
 
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData);
-    if (doc.isNull()) return false;
+void SensorModel::setMemoryLimitMb(int mb) {
+    mb = qMax(mb, 0);
+    if (mb == memoryLimitMb()) return;
+    // Действует со следующей загрузки: открытый набор не перекладывается
+    QSettings().setValue(kMemoryLimitKey, mb);
+    emit memoryLimitChanged();
+}
 
-    QJsonObject root = doc.object();
-    QJsonArray sensorsArray = root["sensors"].toArray();
+bool SensorModel::compressColumns() const {
+    return QSettings().value(kCompressKey, false).toBool();
+}
 
-    beginResetModel();
-    m_sensors.clear();
-
-    for (const QJsonValue &sVal : sensorsArray) {
-        QJsonObject sObj = sVal.toObject();
-        Sensor sensor;
-        sensor.id = sObj["id"].toInt();
-        sensor.name = sObj["name"].toString();
-        QJsonArray dataArr = sObj["data"].toArray();
-        sensor.data.reserve(dataArr.size());
-
-        for (const QJsonValue &dVal : dataArr) {
-            QJsonObject dObj = dVal.toObject();
-            DataPoint dp;
-            dp.time = dObj["t"].toDouble();
-            dp.v1 = dObj["v1"].toDouble();
-            dp.v2 = dObj["v2"].toDouble();
-            dp.v1_corr = dp.v1;
-            dp.v2_corr = dp.v2;
-            sensor.data.append(dp);
-        }
-        m_sensors.append(sensor);
-    }
+void SensorModel::setCompressColumns(bool on) {
+    if (on == compressColumns()) return;
+    QSettings().setValue(kCompressKey, on);
+    emit compressColumnsChanged();
+}
 
-    std::sort(m_sensors.begin(), m_sensors.end(), [](const Sensor& a, const Sensor& b){ return a.id < b.id; });
+double SensorModel::compressionRatio() const {
+    return (m_dataset.store && m_dataset.store->isCompressed()) ? m_dataset.store->compressionRatio() : 0.0;
+}
 
-    preCalculateCalibration();
-    calculateRanges();
-    endResetModel();
-    return true;
+double SensorModel::calibrationWindow() const {
+    return QSettings().value(kCalibrationWindowKey, 0.0).toDouble();
 }
 
-void SensorModel::importFromTxt(const QString &fileUrl) {
-    QString txtPath = QUrl(fileUrl).toLocalFile();
-    if (txtPath.isEmpty()) txtPath = fileUrl;
+void SensorModel::setCalibrationWindow(double seconds) {
+    seconds = qMax(seconds, 0.0);
+    if (seconds == calibrationWindow()) return;
+    QSettings().setValue(kCalibrationWindowKey, seconds);
+    emit calibrationWindowChanged();
+    recalibrate();
+}
 
-    QFileInfo fi(txtPath);
+void SensorModel::recalibrate() {
+    // Идет другая задача - пересчитаем, когда она закончится (onTaskFinished)
+    if (m_busy) {
+        m_recalibratePending = true;
+        return;
+    }
+    m_recalibratePending = false;
+    if (m_dataset.sensors.isEmpty()) return;
+    const double window = calibrationWindow();
+    const bool exclude = excludeAnomalous();
+    // Корзины - проход по отсчетам, поэтому в фоне; копия набора дешевая (implicit sharing)
+    auto result = QSharedPointer<SensorDataset>::create(m_dataset);
+    const quint64 revision = m_dataRevision;
+
+    startTask("calibrate", "Калибровка", [result, window, exclude](TaskControl &) {
+        TraceScope trace("calibrate");
+        result->rolling.window = window;
+        result->anomaly.excludeFromReference = exclude;
+        result->computeDrift();
+        result->preCalculateCalibration();
+        return !result->storageFailed();
+    }, [this, result, revision](bool ok) {
+        // Слежение и синхронный импорт на время задачи стоят (m_busy); если набор
+        // все же сменился, пересчитанная копия устарела и затерла бы новые данные
+        if (!ok || revision != m_dataRevision) return;
+        m_dataset = std::move(*result);
+        ++m_dataRevision;
+        emit dataRangeChanged();
+    });
+}
 
-    // 1. Создаем временный файл для первичного парсинга (в папке с исходником)
+bool SensorModel::excludeAnomalous() const {
+    return QSettings().value(kExcludeAnomalousKey, false).toBool();
+}
 
-    QString tempJsonPath = fi.absolutePath() + "/" + fi.baseName() + "_temp_parsing.json";
+void SensorModel::setExcludeAnomalous(bool on) {
+    if (on == excludeAnomalous()) return;
+    QSettings().setValue(kExcludeAnomalousKey, on);
+    emit excludeAnomalousChanged();
+    // Идущая задача отдаст набор со старой настройкой: пересчет - после нее
+    if (m_busy) {
+        recalibrate();
+        return;
+    }
+    // Флаги уже есть, эталон - по агрегатам: пересчет мгновенный, без фоновой задачи
+    if (m_dataset.sensors.isEmpty()) return;
+    m_dataset.anomaly.excludeFromReference = on;
+    m_dataset.preCalculateCalibration();
+    ++m_dataRevision;
+    emit dataRangeChanged();
+}
 
-    qInfo() << "Step 1: Converting TXT to Temp JSON...";
+DatasetLoadOptions SensorModel::loadOptions() const {
+    DatasetLoadOptions options;
+    options.storage.memoryLimit = qint64(memoryLimitMb()) * 1024 * 1024;
+    options.storage.compress = compressColumns();
+    options.calibrationWindow = calibrationWindow();
+    options.anomaly.excludeFromReference = excludeAnomalous();
+    return options;
+}
 
-    if (convertTxtToJson(txtPath, tempJsonPath)) {
-        // 2. Загружаем данные в модель
-        if (parseJsonInternal(tempJsonPath)) {
-            qInfo() << "Step 2: Data loaded & Math calculated.";
+void SensorModel::restoreLastSession() {
+    const QStringList recent = recentDatasets();
+    if (recent.isEmpty() || !QFile::exists(recent.first())) return;
 
+    // Из кэша это миллисекунды, но и без кэша GUI не должен ждать
+    qInfo() << "Restoring last dataset:" << recent.first();
+    importFromTxtAsync(recent.first());
+}
 
-            // Получаем путь к папке
-            QString exeDir = QCoreApplication::applicationDirPath();
+// ---------------------------------------------------------
+// Фоновые операции
+// ---------------------------------------------------------
+bool SensorModel::startTask(const QString &operation, const QString &text, Task work,
+                            std::function<void(bool)> done) {
+    if (m_busy) {
+        qWarning() << "Operation already running:" << m_operation;
+        return false;
+    }
 
-            // имя файла
-            QString finalJsonName = fi.baseName() + ".json";
-            QString finalJsonPath = QDir(exeDir).filePath(finalJsonName);
+    m_operation = operation;
+    m_operationText = text;
+    m_taskDone = std::move(done);
+    m_control.reset();
+    m_busy = true;
+    updateProgress();
+    emit busyChanged();
+
+    TaskControl *control = &m_control;
+    m_taskWatcher.setFuture(QtConcurrent::run([work, control]() { return work(*control); }));
+    m_progressTimer.start();
+    return true;
+}
 
-            qInfo() << "Step 3: Auto-generating Final JSON at:" << finalJsonPath;
+void SensorModel::onTaskFinished() {
+    m_progressTimer.stop();
+    updateProgress();
 
+    const bool ok = m_taskWatcher.result();
+    const QString operation = m_operation;
+    std::function<void(bool)> done = std::move(m_taskDone);
+    m_taskDone = nullptr;
 
-            exportToJson(finalJsonPath);
+    // Сначала освобождаем слот: done() может запустить следующую операцию
+    m_busy = false;
+    emit busyChanged();
 
-            QFile::remove(tempJsonPath);
-        } else {
-            qWarning() << "Failed to parse generated temp JSON.";
-        }
-    } else {
-        qWarning() << "Failed to convert TXT to JSON.";
-    }
-}
+    if (done) done(ok);
+    emit operationFinished(operation, ok);
+    emit traceChanged();
 
-bool SensorModel::loadResultsFile(const QString &filePath) {
-    if (!QFile::exists(filePath)) return false;
-    importFromTxt(filePath);
-    return !m_sensors.isEmpty();
+    // Настройки калибровки менялись во время задачи: набор еще посчитан по старым
+    if (m_recalibratePending && !m_busy) recalibrate();
 }
 
-void SensorModel::fillSeries(QAbstractSeries *series, int sensorIndex, bool useCorrected, QString channel) {
-    if (!series) return;
-    QXYSeries *xySeries = qobject_cast<QXYSeries *>(series);
-    if (!xySeries) return;
-    if (sensorIndex < 0 || sensorIndex >= m_sensors.size()) return;
-
-    const Sensor &s = m_sensors.at(sensorIndex);
-    QList<QPointF> points;
-    points.reserve(s.data.size());
-    for (const DataPoint &dp : s.data) {
-        double val = (channel == "A") ? (useCorrected ? dp.v1_corr : dp.v1) : (useCorrected ? dp.v2_corr : dp.v2);
-        points.append(QPointF(dp.time, val));
-    }
-    xySeries->replace(points);
+void SensorModel::updateProgress() {
+    const qint64 total = m_control.total();
+    m_progress = (total > 0) ? qBound(0.0, double(m_control.done()) / double(total), 1.0) : 0.0;
+    m_progressText = m_operationText;
+    if (total > 0) m_progressText += QString(": %1%").arg(int(m_progress * 100.0));
+    emit progressChanged();
 }
 
-void SensorModel::calculateRanges() {
-    if (m_sensors.isEmpty()) return;
-    double tMin = std::numeric_limits<double>::max();
-    double tMax = std::numeric_limits<double>::lowest();
-    double vMin = std::numeric_limits<double>::max();
-    double vMax = std::numeric_limits<double>::lowest();
-
-    for (const Sensor &s : m_sensors) {
-        for (const DataPoint &p : s.data) {
-            if (p.time < tMin) tMin = p.time;
-            if (p.time > tMax) tMax = p.time;
-            double localMin = std::min({p.v1, p.v2});
-            double localMax = std::max({p.v1, p.v2});
-            if (localMin < vMin) vMin = localMin;
-            if (localMax > vMax) vMax = localMax;
-        }
-    }
-    double padding = (vMax - vMin) * 0.05;
-    if (padding == 0) padding = 1.0;
-    m_minTime = tMin;
-    m_maxTime = tMax;
-    m_minValue = vMin - padding;
-    m_maxValue = vMax + padding;
-    emit dataRangeChanged();
+void SensorModel::cancelOperation() {
+    if (m_busy) m_control.cancel();
 }
 
-double SensorModel::safeDivide(double target, double current) {
-    return (qAbs(current) > 1e-6) ? (target / current) : 1.0;
+void SensorModel::importFromTxtAsync(const QString &fileUrl) {
+    const QString txtPath = toLocalPath(fileUrl);
+    auto result = QSharedPointer<SensorDataset>::create();
+    const DatasetLoadOptions options = loadOptions();
+
+    startTask("import", "Импорт", [txtPath, result, options](TaskControl &control) {
+        return DatasetLoader::load(txtPath, *result, &control, options);
+    }, [this, txtPath, result](bool ok) {
+        if (!ok) return;
+        // Модель меняется только здесь, когда данные полностью готовы
+        stopFollowing();
+        setDataset(std::move(*result));
+        addRecentDataset(txtPath);
+    });
 }
 
-void SensorModel::preCalculateCalibration() {
-    if (m_sensors.isEmpty()) return;
-    int sensorCount = m_sensors.size();
-    double totalIntensitySum = 0.0;
-    QVector<double> avgH1(sensorCount, 0), avgH2(sensorCount, 0);
-
-    for (int i = 0; i < sensorCount; i++) {
-        const Sensor &sensor = m_sensors.at(i);
-        if (sensor.data.isEmpty()) continue;
-        double sum1 = 0, sum2 = 0;
-        for (const DataPoint &dp : sensor.data) { sum1 += dp.v1; sum2 += dp.v2; }
-        avgH1[i] = sum1 / sensor.data.size();
-        avgH2[i] = sum2 / sensor.data.size();
-        totalIntensitySum += (avgH1[i] + avgH2[i]);
+void SensorModel::importSessionAsync(const QStringList &fileUrls, bool overlay) {
+    QStringList paths;
+    for (const QString &url : fileUrls) paths << toLocalPath(url);
+    if (paths.isEmpty()) return;
+    if (paths.size() == 1 && !overlay) {
+        importFromTxtAsync(paths.first());
+        return;
     }
 
-    m_globalReference = totalIntensitySum / sensorCount;
-    double halfRef = m_globalReference / 2.0;
+    auto result = QSharedPointer<SensorDataset>::create();
+    const DatasetLoadOptions options = loadOptions();
+    const SessionMode mode = overlay ? SessionMode::Overlay : SessionMode::Concatenate;
+
+    startTask("import", overlay ? "Сравнение прогонов" : "Склейка прогонов",
+              [paths, mode, result, options](TaskControl &control) {
+        return DatasetLoader::loadSession(paths, mode, *result, &control, options);
+    }, [this, result](bool ok) {
+        if (!ok) return;
+        stopFollowing();
+        setDataset(std::move(*result));
+    });
+}
 
-    for (int i = 0; i < sensorCount; ++i) {
-        Sensor &s = m_sensors[i];
-        s.kA = safeDivide(halfRef, avgH1[i]);
-        s.kB = safeDivide(halfRef, avgH2[i]);
-        for (DataPoint &dp : s.data) {
-            dp.v1_corr = dp.v1 * s.kA;
-            dp.v2_corr = dp.v2 * s.kB;
+// ---------------------------------------------------------
+// Слежение за дописываемым файлом
+// ---------------------------------------------------------
+void SensorModel::followFile(const QString &fileUrl) {
+    const QString txtPath = toLocalPath(fileUrl);
+    auto result = QSharedPointer<SensorDataset>::create();
+    auto parsedBytes = QSharedPointer<qint64>::create(0);
+    const DatasetLoadOptions settings = loadOptions();
+
+    startTask("import", "Импорт (слежение)", [txtPath, result, parsedBytes, settings](TaskControl &control) {
+        DatasetLoadOptions options = settings;
+        options.parsedBytes = parsedBytes.data();
+        return DatasetLoader::load(txtPath, *result, &control, options);
+    }, [this, txtPath, result, parsedBytes](bool ok) {
+        if (!ok) return;
+        stopFollowing();
+        setDataset(std::move(*result));
+        addRecentDataset(txtPath);
+
+        if (m_follower.start(txtPath, *parsedBytes)) {
+            m_followTimer.start();
+            emit followingChanged();
         }
-    }
+    });
 }
 
-void SensorModel::exportToCsv(const QString &fileUrl) {
-    // 1. Подготовка файла
-    QString path = QUrl(fileUrl).toLocalFile();
-    if (path.isEmpty()) path = fileUrl;
-    if (!path.endsWith(".csv", Qt::CaseInsensitive)) path += ".csv";
+void SensorModel::stopFollowing() {
+    ++m_followGeneration; // идущее чтение хвоста уже не применится
+    if (!m_follower.isActive()) return;
+    m_followTimer.stop();
+    m_follower.stop();
+    emit followingChanged();
+}
 
-    QFile file(path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qWarning() << "Ошибка создания файла:" << path;
-        return;
-    }
+void SensorModel::onFollowTick() {
+    // Пока идет фоновая операция, набор не трогаем: хвост дочитаем следующим тиком.
+    // Предыдущий хвост еще разбирается - тоже ждем
+    if (m_busy || m_followWatcher.isRunning() || !m_follower.isActive()) return;
+
+    // Чтение и разбор - в пуле, GUI-поток только сливает готовые строки
+    auto read = QSharedPointer<FollowRead>::create();
+    read->follower = m_follower;
+    read->generation = m_followGeneration;
+    m_followRead = read;
+    m_followWatcher.setFuture(QtConcurrent::run([read]() {
+        TraceScope trace("followRead");
+        read->status = read->follower.readAppended(read->tail);
+        trace.setRows(read->tail.time.size());
+    }));
+}
 
-    QTextStream out(&file);
-    out.setGenerateByteOrderMark(true); // UTF-8 BOM для Excel
+void SensorModel::onFollowReadFinished() {
+    const QSharedPointer<FollowRead> read = std::move(m_followRead);
+    // Слежение остановлено или перезапущено, либо набор занят задачей: строки не
+    // применяем и смещение не двигаем - их перечитает следующий тик
+    if (!read || read->generation != m_followGeneration || m_busy) return;
+    m_follower = read->follower;
 
-    if (m_sensors.isEmpty()) {
-        file.close();
+    SensorDataset &tail = read->tail;
+    switch (read->status) {
+    case TailFollower::Status::Idle:
+        return;
+    case TailFollower::Status::Reset:
+        qInfo() << "Followed file was truncated, reloading:" << m_follower.path();
+        followFile(m_follower.path());
         return;
+    case TailFollower::Status::Appended:
+        break;
     }
 
-    double totalDev = 0;
-    int countDev = 0;
-    for(const Sensor &s : m_sensors) {
-        totalDev += qAbs(1.0 - s.kA) + qAbs(1.0 - s.kB);
-        countDev += 2;
+    // Новый датчик меняет список модели, остальное - только данные
+    {
+        TraceScope trace("followAppend");
+        trace.setRows(tail.time.size());
+        const bool newSensors = m_dataset.hasNewSensors(tail);
+        if (newSensors) beginResetModel();
+        m_dataset.appendRows(tail);
+        ++m_dataRevision;
+        ++m_samplesRevision;
+        if (newSensors) endResetModel();
+        // Флаги неисправностей могли смениться с новыми строками
+        else if (rowCount() > 0) emit dataChanged(index(0), index(rowCount() - 1), {AnomaliesRole});
     }
-    double avgDevPercent = (countDev > 0) ? (totalDev / countDev) * 100.0 : 0.0;
-
 
+    emit dataRangeChanged();
+    emit dataAppended();
+    emit traceChanged();
+    if (m_correlation.channelCount() > 0) emit correlationChanged(); // матрица устарела
+}
 
+void SensorModel::exportToCsvAsync(const QString &fileUrl, const QVariantMap &options) {
+    const QString path = toLocalPath(fileUrl, ".csv");
+    // Копия дешевая (implicit sharing) и не меняется, пока идет экспорт
+    const SensorDataset snapshot = m_dataset;
+    const CsvExporter::Options csvOptions = toCsvOptions(options);
 
-    QStringList rowCoefs;
-    rowCoefs << "";
+    startTask("csv", "Экспорт CSV", [path, snapshot, csvOptions](TaskControl &control) {
+        return CsvExporter::write(snapshot, path, &control, csvOptions);
+    });
+}
 
-    for (const Sensor &s : m_sensors) {
-        rowCoefs << "";
-        rowCoefs << "";
+void SensorModel::exportToJsonAsync(const QString &fileUrl, bool compact, double step) {
+    const QString path = toLocalPath(fileUrl, ".json");
+    const SensorDataset snapshot = m_dataset;
+    const JsonExporter::Format format = compact ? JsonExporter::Format::Compact : JsonExporter::Format::Indented;
+    // Корреляции - только уже посчитанные (computeCorrelationAsync) для этих отсчетов:
+    // сам экспорт матрицу не считает
+    const CorrelationMatrix correlation = correlationReady() ? m_correlation.matrix() : CorrelationMatrix();
+
+    startTask("json", "Экспорт JSON", [path, snapshot, format, step, correlation](TaskControl &control) {
+        return JsonExporter::write(snapshot, path, &control, format, step,
+                                   correlation.isEmpty() ? nullptr : &correlation);
+    });
+}
 
-        rowCoefs << ("x" + QString::number(s.kA, 'f', 4));
-        rowCoefs << ("x" + QString::number(s.kB, 'f', 4));
+void SensorModel::computeCorrelationAsync() {
+    if (correlationReady()) {
+        emit operationFinished("correlation", true);
+        return;
     }
+    const SensorDataset snapshot = m_dataset;
+    auto result = QSharedPointer<CorrelationMatrix>::create();
+    const quint64 revision = m_samplesRevision;
+
+    startTask("correlation", "Корреляции", [snapshot, result](TaskControl &control) {
+        return CorrelationEngine::compute(snapshot, *result, &control);
+    }, [this, result, revision](bool ok) {
+        if (ok) setCorrelation(*result, revision);
+    });
+}
 
+void SensorModel::setCorrelation(const CorrelationMatrix &matrix, quint64 revision) {
+    // Матрица считалась по снимку набора: принимаем, только если отсчеты те же
+    if (revision != m_samplesRevision) return;
+    m_correlation.setMatrix(matrix);
+    m_correlationRevision = revision;
+    emit correlationChanged();
+}
 
-    rowCoefs << "";
-    rowCoefs << "GLOBAL REFERENCE:";
-    rowCoefs << QString::number(m_globalReference, 'f', 2);
-
-    out << rowCoefs.join(";") << "\n";
-
-
-    QStringList rowHeaders;
-    rowHeaders << "Time (s)";
-
-    for (const Sensor &s : m_sensors) {
-        QString p = s.name;
-        rowHeaders << (p + " Raw A") << (p + " Raw B") << (p + " Corr A") << (p + " Corr B");
-    }
+void SensorModel::exportToColumnsAsync(const QString &fileUrl) {
+    const QString path = toLocalPath(fileUrl, ".scol");
+    const SensorDataset snapshot = m_dataset;
 
+    startTask("columns", "Экспорт колонок", [path, snapshot](TaskControl &control) {
+        return ColumnExporter::write(snapshot, path, &control);
+    });
+}
 
-    rowHeaders << ""; // Пустая колонка-разделитель
-    rowHeaders << "AVG ERROR (%):";
-    rowHeaders << QString::number(avgDevPercent, 'f', 2) + "%";
+// ---------------------------------------------------------
+// График и статистика
+// ---------------------------------------------------------
+void SensorModel::fillSeries(QAbstractSeries *series, int sensorIndex, bool useCorrected, QString channel, int pixelWidth) {
+    invalidateSeries(series);
+    if (sensorIndex < 0 || sensorIndex >= m_dataset.sensors.size()) return;
+    const qsizetype count = m_dataset.sensors.at(sensorIndex).size();
+    fillSeriesSamples(series, sensorIndex, useCorrected, channel, 0, count,
+                      (pixelWidth > 0) ? pixelWidth : kDefaultPixelWidth);
+}
 
-    out << rowHeaders.join(";") << "\n";
+void SensorModel::fillSeriesRange(QAbstractSeries *series, int sensorIndex, bool useCorrected, QString channel,
+                                  double tFrom, double tTo, int maxPoints) {
+    invalidateSeries(series);
+    fillSeriesWindow(series, sensorIndex, useCorrected, channel, tFrom, tTo, maxPoints);
+}
 
+// Серия заполнена в обход updateSeries - следующий пакет перезаполнит ее в любом случае
+void SensorModel::invalidateSeries(QObject *series) {
+    const auto it = m_seriesFills.find(series);
+    if (it != m_seriesFills.end()) *it = SeriesFill();
+}
 
+int SensorModel::updateSeries(const QVariantList &entries, bool useCorrected, double tFrom, double tTo,
+                              int maxPoints) {
+    int filled = 0;
+    for (const QVariant &entry : entries) {
+        const QVariantMap map = entry.toMap();
+        QObject *series = qvariant_cast<QObject *>(map.value("series"));
+        if (!series) continue;
+
+        SeriesFill fill;
+        fill.sensorIndex = map.value("index").toInt();
+        fill.channel = map.value("channel").toString();
+        fill.corrected = useCorrected;
+        fill.tFrom = tFrom;
+        fill.tTo = tTo;
+        fill.maxPoints = maxPoints;
+        fill.revision = m_dataRevision;
+
+        // Серия без датчика (только оси) - пустая
+        if (fill.sensorIndex < 0 || fill.sensorIndex >= m_dataset.sensors.size()) {
+            invalidateSeries(series);
+            if (auto *xySeries = qobject_cast<QXYSeries *>(series)) xySeries->clear();
+            continue;
+        }
 
-    int maxRows = 0;
-    for(const auto& s : m_sensors) if(s.data.size() > maxRows) maxRows = s.data.size();
+        auto it = m_seriesFills.find(series);
+        if (it == m_seriesFills.end()) {
+            // Серию удалили с графика - адрес может достаться новой, запись должна уйти
+            connect(series, &QObject::destroyed, this, [this](QObject *obj) { m_seriesFills.remove(obj); });
+            it = m_seriesFills.insert(series, SeriesFill());
+        } else if (*it == fill) {
+            continue;
+        }
+        *it = fill;
+        fillSeriesWindow(qobject_cast<QAbstractSeries *>(series), fill.sensorIndex, useCorrected, fill.channel,
+                         tFrom, tTo, maxPoints);
+        ++filled;
+    }
+    return filled;
+}
 
-    for (int i = 0; i < maxRows; ++i) {
-        QStringList row;
+void SensorModel::fillSeriesWindow(QAbstractSeries *series, int sensorIndex, bool useCorrected, const QString &channel,
+                                   double tFrom, double tTo, int maxPoints) {
+    if (sensorIndex < 0 || sensorIndex >= m_dataset.sensors.size()) return;
+    qsizetype from = 0, to = 0;
+    m_dataset.sampleRange(m_dataset.sensors.at(sensorIndex), tFrom, tTo, from, to);
+    // Бюджет точек делится на корзины по 2 точки (min и max)
+    fillSeriesSamples(series, sensorIndex, useCorrected, channel, from, to,
+                      qMax(1, ((maxPoints > 0) ? maxPoints : 2 * kDefaultPixelWidth) / 2));
+}
 
-        double t = (!m_sensors.isEmpty() && i < m_sensors[0].data.size()) ? m_sensors[0].data[i].time : 0.0;
-        row << QString::number(t, 'f', 3);
+void SensorModel::fillSeriesSamples(QAbstractSeries *series, int sensorIndex, bool useCorrected, const QString &channel,
+                                    qsizetype from, qsizetype to, int maxBuckets) {
+    if (!series) return;
+    QXYSeries *xySeries = qobject_cast<QXYSeries *>(series);
+    if (!xySeries) return;
+    if (sensorIndex < 0 || sensorIndex >= m_dataset.sensors.size()) return;
 
-        for (const Sensor &s : m_sensors) {
-            if (i < s.data.size()) {
-                const DataPoint &p = s.data[i];
-                row << QString::number(p.v1, 'f', 0);      // Raw A
-                row << QString::number(p.v2, 'f', 0);      // Raw B
-                row << QString::number(p.v1_corr, 'f', 2); // Corr A
-                row << QString::number(p.v2_corr, 'f', 2); // Corr B
-            } else {
-                row << "" << "" << "" << ""; // Если данные кончились
-            }
-        }
+    const qint64 startUs = Tracer::nowUs();
+    if (m_chartCycle.startUs < 0) {
+        m_chartCycle = ChartCycle();
+        m_chartCycle.startUs = startUs;
+        m_chartCycle.peakBefore = Tracer::peakMemoryBytes();
+    }
 
+    // Не больше ~2 точек на корзину: min и max
+    QList<QPointF> points;
+    m_dataset.chartPoints(m_dataset.sensors.at(sensorIndex), (channel == "A") ? 0 : 1, useCorrected,
+                          from, to, maxBuckets, points);
+    xySeries->replace(points);
 
-        out << row.join(";") << "\n";
-    }
+    m_chartCycle.lastFillEndUs = Tracer::nowUs();
+    m_chartCycle.fillUs += m_chartCycle.lastFillEndUs - startUs;
+    m_chartCycle.points += points.size();
+}
 
-    file.close();
+void SensorModel::onFrameRendered() {
+    if (m_chartCycle.startUs < 0) return;
+    const ChartCycle cycle = m_chartCycle;
+    m_chartCycle = ChartCycle();
+
+    // fillSeries - сумма времени вызовов (между ними работает QML),
+    // chartRedraw - от последнего заполнения до отрисованного кадра
+    TraceEvent fill;
+    fill.name = "fillSeries";
+    fill.category = "chart";
+    fill.startUs = cycle.startUs;
+    fill.durationUs = cycle.fillUs;
+    fill.rows = cycle.points;
+    fill.memoryBytes = Tracer::memoryBytes();
+    fill.peakBytes = Tracer::peakMemoryBytes();
+    fill.peakGrowth = fill.peakBytes - cycle.peakBefore;
+
+    TraceEvent redraw = fill;
+    redraw.name = "chartRedraw";
+    redraw.startUs = cycle.lastFillEndUs;
+    redraw.durationUs = Tracer::nowUs() - cycle.lastFillEndUs;
+    redraw.peakGrowth = 0;
+
+    Tracer::instance().record(fill);
+    Tracer::instance().record(redraw);
+    emit traceChanged();
 }
 
+QColor SensorModel::sensorColor(int index) const {
+    if (index < 0) return Qt::black;
+    // Шаг по оттенку - золотое сечение: соседние датчики не сливаются при любом их числе
+    return QColor::fromHslF(float(std::fmod(index * 0.618033988749895, 1.0)), 0.75f, 0.5f);
+}
 
 QVariantMap SensorModel::getSensorStats(int index) {
+    const QVector<Sensor> &sensors = m_dataset.sensors;
     QVariantMap map;
-    if (index < 0 || index >= m_sensors.size()) {
+    if (index < 0 || index >= sensors.size()) {
         map["type"] = "all";
-        map["reference"] = m_globalReference;
-        double totalDev = 0;
-        int count = 0;
-        for(const Sensor &s : m_sensors) {
-            totalDev += qAbs(1.0 - s.kA) + qAbs(1.0 - s.kB);
-            count += 2;
-        }
-        map["avgCorrection"] = (count > 0) ? (totalDev / count) : 0.0;
+        map["reference"] = m_dataset.globalReference;
+        map["avgCorrection"] = m_dataset.avgDeviation;
+        map["rollingWindow"] = m_dataset.rolling.isActive() ? m_dataset.rolling.window : 0.0;
+        int flagged = 0;
+        for (const Sensor &s : sensors) flagged += (s.anomalies != 0);
+        map["anomalous"] = flagged;
+        map["excludeAnomalous"] = m_dataset.anomaly.excludeFromReference;
         return map;
     }
 
-    const Sensor &s = m_sensors.at(index);
+    const Sensor &s = sensors.at(index);
     map["type"] = "single";
     map["name"] = s.name;
     map["kA"] = s.kA;
@@ -484,16 +663,68 @@ QVariantMap SensorModel::getSensorStats(int index) {
     map["pA"] = qAbs(s.kA - 1.0) * 100.0;
     map["pB"] = qAbs(s.kB - 1.0) * 100.0;
 
-    double avgRawA = 0, avgRawB = 0;
-    if (!s.data.isEmpty()) {
-        double sumRawA = 0, sumRawB = 0;
-        for (const DataPoint& data : s.data) {
-            sumRawA += data.v1;
-            sumRawB += data.v2;
+    // Скользящая калибровка: коэффициенты в центрах корзин
+    const RollingCalibration &rolling = m_dataset.rolling;
+    if (rolling.isActive()) {
+        QVariantList timeline;
+        const qsizetype n = qMax(s.driftA.k.size(), s.driftB.k.size());
+        for (qsizetype j = 0; j < n; ++j) {
+            const double t = rolling.centerTime(j);
+            timeline.append(QVariantMap{{"t", t},
+                                        {"kA", rolling.interpolate(s.driftA.k, t, s.kA)},
+                                        {"kB", rolling.interpolate(s.driftB.k, t, s.kB)}});
         }
-        avgRawA = sumRawA / s.data.size();
-        avgRawB = sumRawB / s.data.size();
+        map["timeline"] = timeline;
     }
+
+    // Средние уже посчитаны при загрузке
+    double avgRawA = s.statsA.mean(), avgRawB = s.statsB.mean();
     map["avgRawA"] = avgRawA; map["avgRawB"] = avgRawB;
+
+    // Неисправности по каналам (потоковые детекторы разбора)
+    map["anomaliesA"] = AnomalyDetector::describe(s.monitorA.flags(m_dataset.anomaly));
+    map["anomaliesB"] = AnomalyDetector::describe(s.monitorB.flags(m_dataset.anomaly));
+    map["excluded"] = m_dataset.anomaly.excludeFromReference && s.anomalies != 0;
     return map;
 }
+
+QVariantMap SensorModel::getWindowStats(int index, double tFrom, double tTo) {
+    QVariantMap map;
+    if (index < 0 || index >= m_dataset.sensors.size()) return map;
+
+    const Sensor &s = m_dataset.sensors.at(index);
+    const WindowStats a = m_dataset.windowStats(s, 0, tFrom, tTo);
+    const WindowStats b = m_dataset.windowStats(s, 1, tFrom, tTo);
+    map["countA"] = a.count; map["meanA"] = a.mean; map["stddevA"] = a.stddev; map["minA"] = a.min; map["maxA"] = a.max;
+    map["countB"] = b.count; map["meanB"] = b.mean; map["stddevB"] = b.stddev; map["minB"] = b.min; map["maxB"] = b.max;
+    return map;
+}
+
+// ---------------------------------------------------------
+// Трассировка стадий
+// ---------------------------------------------------------
+QVariantList SensorModel::traceStages() const {
+    QVariantList list;
+    for (const TraceEvent &e : Tracer::instance().latestPerStage()) {
+        QVariantMap map;
+        map["name"] = QString::fromLatin1(e.name);
+        map["category"] = QString::fromLatin1(e.category);
+        map["ms"] = e.durationUs / 1000.0;
+        map["bytes"] = e.bytes;
+        map["rows"] = e.rows;
+        map["memoryMb"] = e.memoryBytes / 1048576.0;
+        map["peakMb"] = e.peakBytes / 1048576.0;
+        map["peakGrowthMb"] = e.peakGrowth / 1048576.0;
+        list.append(map);
+    }
+    return list;
+}
+
+bool SensorModel::exportTrace(const QString &fileUrl) {
+    return Tracer::instance().writeChromeTrace(toLocalPath(fileUrl, ".json"));
+}
+
+void SensorModel::clearTrace() {
+    Tracer::instance().clear();
+    emit traceChanged();
+}
@@ -2,30 +2,27 @@
 #define SENSORMODEL_H
 
 #include <QAbstractListModel>
+#include <QColor>
 #include <QVector>
+#include <QHash>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QJsonDocument>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QSharedPointer>
 #include <QtCharts/QAbstractSeries>
 #include <QtCharts/QXYSeries>
 
-struct DataPoint {
-    double time;
-    double v1;      // Raw A
-    double v2;      // Raw B
-    double v1_corr; // Corrected A
-    double v2_corr; // Corrected B
-};
+#include <functional>
 
-struct Sensor {
-    int id;
-    QString name;
-    QVector<DataPoint> data;
-    double kA = 1.0;
-    double kB = 1.0;
-};
+#include "sensordata.h"
+#include "taskcontrol.h"
+#include "tailfollower.h"
+#include "csvexporter.h"
+#include "correlationmodel.h"
+
+struct DatasetLoadOptions;
 
 class SensorModel : public QAbstractListModel
 {
@@ -36,53 +33,258 @@ class SensorModel : public QAbstractListModel
     Q_PROPERTY(double maxValue READ maxValue NOTIFY dataRangeChanged)
     Q_PROPERTY(double globalReference READ globalReference NOTIFY dataRangeChanged)
 
+    // Фоновая операция (импорт/экспорт)
+    Q_PROPERTY(bool busy READ busy NOTIFY busyChanged)
+    Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(qint64 progressDone READ progressDone NOTIFY progressChanged)
+    Q_PROPERTY(qint64 progressTotal READ progressTotal NOTIFY progressChanged)
+    Q_PROPERTY(QString progressText READ progressText NOTIFY progressChanged)
+
+    Q_PROPERTY(QStringList recentDatasets READ recentDatasets NOTIFY recentDatasetsChanged)
+    Q_PROPERTY(bool following READ following NOTIFY followingChanged)
+
+    // Лимит памяти на набор, МБ (0 - без лимита): больше - колонки кусками на диске
+    Q_PROPERTY(int memoryLimitMb READ memoryLimitMb WRITE setMemoryLimitMb NOTIFY memoryLimitChanged)
+    Q_PROPERTY(bool outOfCore READ outOfCore NOTIFY dataRangeChanged)
+    // Сжатие колонок в памяти (со следующей загрузки); степень сжатия текущего набора, 0 - не сжат
+    Q_PROPERTY(bool compressColumns READ compressColumns WRITE setCompressColumns NOTIFY compressColumnsChanged)
+    Q_PROPERTY(double compressionRatio READ compressionRatio NOTIFY dataRangeChanged)
+    // Окно скользящей калибровки, с (0 - один коэффициент на канал); меняет и открытый набор
+    Q_PROPERTY(double calibrationWindow READ calibrationWindow WRITE setCalibrationWindow
+                   NOTIFY calibrationWindowChanged)
+    // Датчики с флагами неисправности не входят в эталон калибровки; меняет и открытый набор
+    Q_PROPERTY(bool excludeAnomalous READ excludeAnomalous WRITE setExcludeAnomalous
+                   NOTIFY excludeAnomalousChanged)
+
+    // Корреляции каналов (тепловая карта); считаются по computeCorrelationAsync и
+    // держатся, пока не сменятся отсчеты (калибровка на них не влияет)
+    Q_PROPERTY(CorrelationModel *correlation READ correlation CONSTANT)
+    Q_PROPERTY(bool correlationReady READ correlationReady NOTIFY correlationChanged)
+
+    // Последний замер каждой стадии конвейера (оверлей производительности)
+    Q_PROPERTY(QVariantList traceStages READ traceStages NOTIFY traceChanged)
+
 public:
-    enum Roles { IdRole = Qt::UserRole + 1, NameRole, DataRole };
+    enum Roles { IdRole = Qt::UserRole + 1, NameRole, DataRole, AnomaliesRole };
 
     explicit SensorModel(QObject *parent = nullptr);
+    ~SensorModel() override;
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     QHash<int, QByteArray> roleNames() const override;
 
-    double globalReference() const { return m_globalReference; }
-    double minTime() const { return m_minTime; }
-    double maxTime() const { return m_maxTime; }
-    double minValue() const { return m_minValue; }
-    double maxValue() const { return m_maxValue; }
+    // Набор целиком - для элементов, читающих колонки напрямую (SensorPlot); только GUI-поток
+    const SensorDataset &dataset() const { return m_dataset; }
+
+    double globalReference() const { return m_dataset.globalReference; }
+    double minTime() const { return m_dataset.minTime; }
+    double maxTime() const { return m_dataset.maxTime; }
+    double minValue() const { return m_dataset.minValue; }
+    double maxValue() const { return m_dataset.maxValue; }
+
+    bool busy() const { return m_busy; }
+    double progress() const { return m_progress; }
+    qint64 progressDone() const { return m_control.done(); }
+    qint64 progressTotal() const { return m_control.total(); }
+    QString progressText() const { return m_progressText; }
+
+    QStringList recentDatasets() const;
+    bool following() const { return m_follower.isActive(); }
+    int memoryLimitMb() const;
+    void setMemoryLimitMb(int mb);
+    bool outOfCore() const { return m_dataset.store && !m_dataset.store->isCompressed(); }
+    bool compressColumns() const;
+    void setCompressColumns(bool on);
+    double compressionRatio() const;
+    double calibrationWindow() const;
+    void setCalibrationWindow(double seconds);
+    bool excludeAnomalous() const;
+    void setExcludeAnomalous(bool on);
+    QVariantList traceStages() const;
+    CorrelationModel *correlation() { return &m_correlation; }
+    bool correlationReady() const { return m_correlationRevision == m_samplesRevision && m_correlation.channelCount() > 0; }
 
     // --- ФУНКЦИИ, ДОСТУПНЫЕ ИЗ QML ---
     Q_INVOKABLE void importFromTxt(const QString &fileUrl);
     Q_INVOKABLE void exportToCsv(const QString &fileUrl);
 
     // !!! ВОТ ЭТОЙ СТРОКИ НЕ ХВАТАЛО !!!
-    Q_INVOKABLE void exportToJson(const QString &fileUrl);
+    // compact - без отступов (файл в 2-3 раза меньше)
+    Q_INVOKABLE void exportToJson(const QString &fileUrl, bool compact = false);
+
+    // Фоновые версии: GUI не блокируется, прогресс - в progress/progressText,
+    // по окончании - operationFinished("import" | "csv" | "json" | "columns", ok)
+    Q_INVOKABLE void importFromTxtAsync(const QString &fileUrl);
+    // Несколько прогонов одной сессией: overlay = false - склейка по времени
+    // (датчики S<n> общие), true - прогоны рядом, каждый от своего начала
+    Q_INVOKABLE void importSessionAsync(const QStringList &fileUrls, bool overlay);
+    // options: { raw, corrected, sensors: [id...], tFrom, tTo, step } - все ключи необязательны;
+    // step > 0 - строки на сетке с этим шагом (средние по узлу), то же step у JSON
+    Q_INVOKABLE void exportToCsvAsync(const QString &fileUrl, const QVariantMap &options = QVariantMap());
+    // statistics.correlation пишется, только если матрица уже посчитана (correlationReady)
+    Q_INVOKABLE void exportToJsonAsync(const QString &fileUrl, bool compact = false, double step = 0.0);
+    // Бинарные колонки (.scol) для numpy/pandas, формат - в columnexporter.h
+    Q_INVOKABLE void exportToColumnsAsync(const QString &fileUrl);
+    // Матрица корреляций в фоне (operationFinished("correlation", ok)); если отсчеты
+    // с прошлого расчета не менялись - сразу из кэша
+    Q_INVOKABLE void computeCorrelationAsync();
+    Q_INVOKABLE void cancelOperation();
 
-    Q_INVOKABLE void fillSeries(QAbstractSeries *series, int sensorIndex, bool useCorrected, QString channel);
+    // pixelWidth - ширина области графика: серия получает ~2 * pixelWidth точек
+    Q_INVOKABLE void fillSeries(QAbstractSeries *series, int sensorIndex, bool useCorrected, QString channel,
+                                int pixelWidth = 0);
+    // Только видимое окно [tFrom, tTo], не больше ~maxPoints точек (для зума и прокрутки)
+    Q_INVOKABLE void fillSeriesRange(QAbstractSeries *series, int sensorIndex, bool useCorrected, QString channel,
+                                     double tFrom, double tTo, int maxPoints);
+    // Все серии графика за один вызов: entries - [{ series, index, channel }], окно и
+    // бюджет точек - как у fillSeriesRange. Серия перезаполняется, только если с прошлого
+    // вызова сменились ее датчик, канал, режим, окно, бюджет или сами данные.
+    // Серия с index вне набора очищается (держит только оси).
+    // Возвращает число перезаполненных серий.
+    Q_INVOKABLE int updateSeries(const QVariantList &entries, bool useCorrected, double tFrom, double tTo,
+                                 int maxPoints);
     Q_INVOKABLE QVariantMap getSensorStats(int index);
+    // Цвет датчика: один на список, подписи и кривые (SensorPlot, серии QtCharts)
+    Q_INVOKABLE QColor sensorColor(int index) const;
+    // Статистика сырых каналов датчика на окне [tFrom, tTo]: count/mean/stddev/min/max + A|B
+    Q_INVOKABLE QVariantMap getWindowStats(int index, double tFrom, double tTo);
+
+    // Импорт с последующим слежением: дописанные в файл строки подхватываются
+    // не чаще раза в kFollowRefreshMs (dataAppended), без повторного разбора файла
+    Q_INVOKABLE void followFile(const QString &fileUrl);
+    Q_INVOKABLE void stopFollowing();
+
+    // Открывает последний набор из списка недавних (из кэша - без разбора TXT)
+    Q_INVOKABLE void restoreLastSession();
+
+    // Все записанные замеры в формате Chrome trace-event (chrome://tracing, Perfetto)
+    Q_INVOKABLE bool exportTrace(const QString &fileUrl);
+    Q_INVOKABLE void clearTrace();
 
     // Внутренние методы
     bool loadResultsFile(const QString &filePath);
 
+public slots:
+    // Кадр с графиком отрисован: закрывает замер fillSeries + chartRedraw
+    void onFrameRendered();
+
 signals:
     void dataRangeChanged();
+    void busyChanged();
+    void progressChanged();
+    void operationFinished(const QString &operation, bool ok);
+    void recentDatasetsChanged();
+    void followingChanged();
+    void memoryLimitChanged();
+    void compressColumnsChanged();
+    void calibrationWindowChanged();
+    void excludeAnomalousChanged();
+    void datasetReplaced(); // загружен другой набор (импорт)
+    void dataAppended();    // в текущий набор дописаны строки (слежение)
+    void traceChanged();
+    void correlationChanged();
 
 private:
-    void calculateRanges();
-    void preCalculateCalibration();
+    static constexpr int kDefaultPixelWidth = 2000;
+    static constexpr int kMaxRecent = 10;
+    static constexpr int kFollowRefreshMs = 250;
+    static constexpr const char *kRecentKey = "recentDatasets";
+    static constexpr const char *kMemoryLimitKey = "memoryLimitMb";
+    static constexpr const char *kCompressKey = "compressColumns";
+    static constexpr const char *kCalibrationWindowKey = "calibrationWindowSec";
+    static constexpr const char *kExcludeAnomalousKey = "excludeAnomalous";
+
+    using Task = std::function<bool(TaskControl &)>;
+
     QVariant sensorDataToVariantList(const Sensor &s) const;
-    static double safeDivide(double target, double current);
-
-    // Парсеры
-    bool convertTxtToJson(const QString &txtFilePath, const QString &jsonFilePath);
-    bool parseJsonInternal(const QString &jsonFilePath);
-
-    QVector<Sensor> m_sensors;
-    double m_minTime = 0.0;
-    double m_maxTime = 10.0;
-    double m_minValue = 0.0;
-    double m_maxValue = 100.0;
-    double m_globalReference = 0.0;
+    void invalidateSeries(QObject *series);
+    void fillSeriesWindow(QAbstractSeries *series, int sensorIndex, bool useCorrected, const QString &channel,
+                          double tFrom, double tTo, int maxPoints);
+    void fillSeriesSamples(QAbstractSeries *series, int sensorIndex, bool useCorrected, const QString &channel,
+                           qsizetype from, qsizetype to, int maxBuckets);
+
+    static QString toLocalPath(const QString &fileUrl, const QString &suffix = QString());
+    static CsvExporter::Options toCsvOptions(const QVariantMap &map);
+    void addRecentDataset(const QString &txtPath);
+    // Общие настройки загрузки из QSettings (лимит памяти, сжатие, окно калибровки)
+    DatasetLoadOptions loadOptions() const;
+
+    // Атомарная подмена данных модели (только из GUI-потока)
+    void setDataset(SensorDataset &&dataset);
+
+    bool startTask(const QString &operation, const QString &text, Task work,
+                   std::function<void(bool)> done = {});
+    void onTaskFinished();
+    void updateProgress();
+    void onFollowTick();
+    // Хвост разобран в пуле: применение на GUI-потоке
+    void onFollowReadFinished();
+    // Пересчет калибровки открытого набора после смены окна или эталона (в фоне; если
+    // занято - после текущей задачи)
+    void recalibrate();
+    // Готовая матрица корреляций для отсчетов ревизии revision
+    void setCorrelation(const CorrelationMatrix &matrix, quint64 revision);
+
+    SensorDataset m_dataset;
+    quint64 m_dataRevision = 0; // растет при каждой смене данных (dataRangeChanged)
+    quint64 m_samplesRevision = 0; // только при смене отсчетов (импорт, дописывание)
+
+    CorrelationModel m_correlation;
+    quint64 m_correlationRevision = 0;
+
+    QFutureWatcher<bool> m_taskWatcher;
+    QTimer m_progressTimer;
+    TaskControl m_control;
+    std::function<void(bool)> m_taskDone;
+    QString m_operation;
+    QString m_operationText;
+    QString m_progressText;
+    double m_progress = 0.0;
+    bool m_busy = false;
+    bool m_recalibratePending = false;
+
+    TailFollower m_follower;
+    QTimer m_followTimer;
+
+    // Чтение хвоста идет в пуле на копии follower: смещение сдвигается, только
+    // когда строки применены. generation отсекает результат остановленного слежения
+    struct FollowRead {
+        TailFollower follower;
+        TailFollower::Status status = TailFollower::Status::Idle;
+        SensorDataset tail;
+        quint64 generation = 0;
+    };
+    QFutureWatcher<void> m_followWatcher;
+    QSharedPointer<FollowRead> m_followRead;
+    quint64 m_followGeneration = 0;
+
+    // Заполнение серий от первого fillSeries до отрисованного кадра
+    struct ChartCycle {
+        qint64 startUs = -1; // -1 - заполнений после последнего кадра не было
+        qint64 lastFillEndUs = 0;
+        qint64 fillUs = 0;   // суммарное время самих fillSeries
+        qint64 points = 0;
+        qint64 peakBefore = 0;
+    };
+    ChartCycle m_chartCycle;
+
+    // Чем заполнена серия при последнем updateSeries
+    struct SeriesFill {
+        int sensorIndex = -1;
+        QString channel;
+        bool corrected = false;
+        double tFrom = 0.0;
+        double tTo = 0.0;
+        int maxPoints = 0;
+        quint64 revision = 0;
+
+        bool operator==(const SeriesFill &o) const {
+            return sensorIndex == o.sensorIndex && channel == o.channel && corrected == o.corrected
+                   && tFrom == o.tFrom && tTo == o.tTo && maxPoints == o.maxPoints && revision == o.revision;
+        }
+    };
+    QHash<QObject *, SeriesFill> m_seriesFills;
 };
 
 #endif // SENSORMODEL_H
@@ -0,0 +1,233 @@
+#include "sensorplot.h"
+#include "tracer.h"
+
+#include <QQuickWindow>
+#include <QSGTransformNode>
+#include <QSGGeometryNode>
+#include <QSGFlatColorMaterial>
+#include <QSGImageNode>
+#include <QSGRendererInterface>
+#include <QPainter>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtMath>
+
+#include <cmath>
+
+SensorPlot::SensorPlot(QQuickItem *parent) : QQuickItem(parent) {
+    setFlag(ItemHasContents, true);
+}
+
+void SensorPlot::setModel(SensorModel *model) {
+    if (m_model == model) return;
+    if (m_model) disconnect(m_model, nullptr, this, nullptr);
+    m_model = model;
+    // dataRangeChanged приходит при любой смене данных: замена набора, дописывание, калибровка
+    if (m_model) connect(m_model, &SensorModel::dataRangeChanged, this, &SensorPlot::invalidatePoints);
+    invalidatePoints();
+    emit modelChanged();
+}
+
+void SensorPlot::setCorrected(bool corrected) {
+    if (m_corrected == corrected) return;
+    m_corrected = corrected;
+    invalidatePoints();
+    emit correctedChanged();
+}
+
+void SensorPlot::setMinTime(double t) {
+    if (m_minTime == t) return;
+    m_minTime = t;
+    invalidatePoints();
+    emit viewChanged();
+}
+
+void SensorPlot::setMaxTime(double t) {
+    if (m_maxTime == t) return;
+    m_maxTime = t;
+    invalidatePoints();
+    emit viewChanged();
+}
+
+// Диапазон значений - только матрица, точки те же
+void SensorPlot::setMinValue(double v) {
+    if (m_minValue == v) return;
+    m_minValue = v;
+    update();
+    emit viewChanged();
+}
+
+void SensorPlot::setMaxValue(double v) {
+    if (m_maxValue == v) return;
+    m_maxValue = v;
+    update();
+    emit viewChanged();
+}
+
+void SensorPlot::invalidatePoints() {
+    m_pointsDirty = true;
+    polish();
+}
+
+void SensorPlot::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) {
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    // Ширина меняет число корзин прореживания, высота - только матрицу
+    if (qMax(1, qCeil(newGeometry.width())) != m_buckets) invalidatePoints();
+    else update();
+}
+
+void SensorPlot::updatePolish() {
+    if (!m_pointsDirty) return;
+    m_pointsDirty = false;
+    update();
+
+    // Какие кривые нужны сейчас
+    QVector<Trace> wanted;
+    const SensorDataset *dataset = m_model ? &m_model->dataset() : nullptr;
+    const int sensorCount = dataset ? int(dataset->sensors.size()) : 0;
+    wanted.resize(sensorCount);
+    for (int i = 0; i < sensorCount; ++i) {
+        wanted[i].sensorIndex = i;
+        wanted[i].color = m_model->sensorColor(i);
+    }
+
+    // Кривые на тех же местах сохраняют точки: если они не поменяются, узел не трогается
+    m_traces.resize(wanted.size());
+    for (qsizetype i = 0; i < wanted.size(); ++i) {
+        Trace &t = m_traces[i];
+        if (t.sensorIndex != wanted[i].sensorIndex) {
+            t.sensorIndex = wanted[i].sensorIndex;
+            t.points.clear();
+            t.dirty = true;
+        }
+        if (t.color != wanted[i].color) {
+            t.color = wanted[i].color;
+            t.dirty = true;
+        }
+    }
+    if (m_traces.isEmpty()) return;
+
+    TraceScope trace("plotPolish", "chart");
+    m_buckets = qMax(1, qCeil(width()));
+    m_origin = m_minTime;
+    const double tFrom = m_minTime, tTo = m_maxTime, origin = m_origin;
+    const int buckets = m_buckets;
+    const bool corrected = m_corrected;
+
+    // Прореживание по датчикам параллельно: чтение колонок (и страниц с диска) потокобезопасно
+    QtConcurrent::blockingMap(m_traces, [dataset, tFrom, tTo, origin, buckets, corrected](Trace &t) {
+        const Sensor &s = dataset->sensors.at(t.sensorIndex);
+        qsizetype from = 0, to = 0;
+        dataset->sampleRange(s, tFrom, tTo, from, to);
+        QList<QPointF> points;
+        dataset->chartPoints(s, 0, corrected, from, to, buckets, points);
+        for (QPointF &p : points) p.rx() -= origin;
+        if (points != t.points) {
+            t.points = std::move(points);
+            t.dirty = true;
+        }
+    });
+
+    qint64 total = 0;
+    for (const Trace &t : std::as_const(m_traces)) total += t.points.size();
+    trace.setRows(total);
+}
+
+bool SensorPlot::dataToItem(QTransform &transform) const {
+    if (width() <= 0 || height() <= 0 || m_maxTime <= m_minTime || m_maxValue <= m_minValue) return false;
+    // x = (t - minTime) * sx, y = height - (v - minValue) * sy; t в точках - от m_origin
+    const double sx = width() / (m_maxTime - m_minTime);
+    const double sy = height() / (m_maxValue - m_minValue);
+    transform = QTransform(sx, 0.0, 0.0, -sy, (m_origin - m_minTime) * sx, height() + m_minValue * sy);
+    return true;
+}
+
+QSGNode *SensorPlot::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *) {
+    const bool software = window()
+                          && window()->rendererInterface()->graphicsApi() == QSGRendererInterface::Software;
+    return software ? updateSoftwareNode(oldNode) : updateGeometryNodes(oldNode);
+}
+
+QSGNode *SensorPlot::updateGeometryNodes(QSGNode *oldNode) {
+    auto *root = static_cast<QSGTransformNode *>(oldNode);
+    if (!root) root = new QSGTransformNode;
+
+    // Кривых стало меньше - лишние узлы с конца
+    while (root->childCount() > m_traces.size()) {
+        QSGNode *last = root->lastChild();
+        root->removeChildNode(last);
+        delete last;
+    }
+
+    QSGNode *child = root->firstChild();
+    for (Trace &t : m_traces) {
+        auto *node = static_cast<QSGGeometryNode *>(child);
+        if (!node) {
+            node = new QSGGeometryNode;
+            auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+            geometry->setDrawingMode(QSGGeometry::DrawLineStrip);
+            geometry->setLineWidth(1);
+            node->setGeometry(geometry);
+            node->setFlag(QSGNode::OwnsGeometry);
+            node->setMaterial(new QSGFlatColorMaterial);
+            node->setFlag(QSGNode::OwnsMaterial);
+            root->appendChildNode(node);
+            t.dirty = true;
+        }
+        child = node->nextSibling();
+        if (!t.dirty) continue;
+        t.dirty = false;
+
+        auto *material = static_cast<QSGFlatColorMaterial *>(node->material());
+        if (material->color() != t.color) {
+            material->setColor(t.color);
+            node->markDirty(QSGNode::DirtyMaterial);
+        }
+
+        QSGGeometry *geometry = node->geometry();
+        geometry->allocate(int(t.points.size()));
+        QSGGeometry::Point2D *v = geometry->vertexDataAsPoint2D();
+        for (qsizetype i = 0; i < t.points.size(); ++i) {
+            v[i].set(float(t.points[i].x()), float(t.points[i].y()));
+        }
+        node->markDirty(QSGNode::DirtyGeometry);
+    }
+
+    // Вершины в координатах данных - размер и диапазон значений меняют только матрицу
+    QTransform transform;
+    QMatrix4x4 matrix;
+    if (dataToItem(transform)) matrix = QMatrix4x4(transform);
+    else matrix.scale(0.0f);
+    if (root->matrix() != matrix) root->setMatrix(matrix);
+    return root;
+}
+
+QSGNode *SensorPlot::updateSoftwareNode(QSGNode *oldNode) {
+    auto *node = static_cast<QSGImageNode *>(oldNode);
+    if (!node) {
+        node = window()->createImageNode();
+        node->setOwnsTexture(true);
+    }
+
+    TraceScope trace("plotPaint", "chart");
+    const qreal dpr = window()->effectiveDevicePixelRatio();
+    QImage image(qMax(1, qCeil(width() * dpr)), qMax(1, qCeil(height() * dpr)), QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(Qt::transparent);
+
+    QTransform transform;
+    if (dataToItem(transform)) {
+        QPainter painter(&image);
+        QPolygonF line;
+        for (Trace &t : m_traces) {
+            t.dirty = false;
+            line = transform.map(QPolygonF(t.points));
+            painter.setPen(QPen(t.color, 0)); // косметическое перо - 1 пиксель, как у узлов
+            painter.drawPolyline(line);
+        }
+    }
+
+    // Старую текстуру узел удаляет сам (ownsTexture)
+    node->setTexture(window()->createTextureFromImage(image));
+    node->setRect(boundingRect());
+    return node;
+}
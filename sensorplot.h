@@ -0,0 +1,96 @@
+#ifndef SENSORPLOT_H
+#define SENSORPLOT_H
+
+#include <QQuickItem>
+#include <QPointer>
+#include <QColor>
+#include <QList>
+#include <QPointF>
+#include <QTransform>
+#include <QVector>
+
+#include "sensormodel.h"
+
+// График всех датчиков без ChartView: каждая кривая - узел геометрии сцены
+// (полилиния, стандартный материал одного цвета) под общим узлом преобразования.
+//
+// Точки берутся прямо из колонок набора модели (SensorDataset::chartPoints, то же
+// прореживание, что у серий) в updatePolish на GUI-потоке; в updatePaintNode
+// перезаливается только геометрия кривых, чьи точки поменялись. Вершины - в
+// координатах данных, поэтому смена диапазона значений или размера элемента
+// меняет одну матрицу, а не геометрию.
+//
+// Цвета - как getSensorColor в main.qml.
+//
+// У программного бэкенда Qt Quick (QT_QUICK_BACKEND=software) узлов с произвольной
+// геометрией нет: там кривые рисуются QPainter в картинку размером с элемент,
+// которая показывается одним узлом изображения. Перерисовка - целиком на каждый
+// кадр с изменениями, точки и прореживание те же.
+class SensorPlot : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(SensorModel *model READ model WRITE setModel NOTIFY modelChanged)
+    Q_PROPERTY(bool corrected READ corrected WRITE setCorrected NOTIFY correctedChanged)
+    // Видимое окно: время по X, значения по Y (как у осей графика)
+    Q_PROPERTY(double minTime READ minTime WRITE setMinTime NOTIFY viewChanged)
+    Q_PROPERTY(double maxTime READ maxTime WRITE setMaxTime NOTIFY viewChanged)
+    Q_PROPERTY(double minValue READ minValue WRITE setMinValue NOTIFY viewChanged)
+    Q_PROPERTY(double maxValue READ maxValue WRITE setMaxValue NOTIFY viewChanged)
+
+public:
+    explicit SensorPlot(QQuickItem *parent = nullptr);
+
+    SensorModel *model() const { return m_model; }
+    void setModel(SensorModel *model);
+    bool corrected() const { return m_corrected; }
+    void setCorrected(bool corrected);
+
+    double minTime() const { return m_minTime; }
+    void setMinTime(double t);
+    double maxTime() const { return m_maxTime; }
+    void setMaxTime(double t);
+    double minValue() const { return m_minValue; }
+    void setMinValue(double v);
+    double maxValue() const { return m_maxValue; }
+    void setMaxValue(double v);
+
+signals:
+    void modelChanged();
+    void correctedChanged();
+    void viewChanged();
+
+protected:
+    void updatePolish() override;
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *) override;
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+
+private:
+    struct Trace {
+        int sensorIndex = -1;
+        QColor color;
+        QList<QPointF> points; // время - от m_origin
+        bool dirty = true;     // точки или цвет не залиты в узел
+    };
+
+    // Точки пересчитываются при следующем updatePolish
+    void invalidatePoints();
+    // Данные -> пиксели элемента; false - окно или размер вырождены
+    bool dataToItem(QTransform &transform) const;
+    // Узлы геометрии (RHI) и картинка QPainter (программный бэкенд)
+    QSGNode *updateGeometryNodes(QSGNode *oldNode);
+    QSGNode *updateSoftwareNode(QSGNode *oldNode);
+
+    QPointer<SensorModel> m_model;
+    bool m_corrected = false;
+    double m_minTime = 0.0;
+    double m_maxTime = 1.0;
+    double m_minValue = 0.0;
+    double m_maxValue = 1.0;
+
+    QVector<Trace> m_traces;
+    double m_origin = 0.0;      // начало отсчета времени в вершинах (float)
+    bool m_pointsDirty = true;  // данные, окно времени, режим или ширина поменялись
+    int m_buckets = 0;          // корзин прореживания на кривую (~ пиксели ширины)
+};
+
+#endif // SENSORPLOT_H
@@ -0,0 +1,185 @@
+#include "sessionmerger.h"
+
+#include <QDebug>
+#include <QMap>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Датчик sensor прогона run
+struct Source {
+    int run;
+    int sensor;
+};
+
+// Датчик сессии: из каких прогонов собирается и какие строки сессии занимает
+struct Output {
+    int id = 0;
+    QString name;
+    QVector<Source> sources;
+    qsizetype offset = 0;
+    qsizetype end = 0; // 0 - ни одного отсчета
+};
+
+} // namespace
+
+bool SessionMerger::merge(const QVector<SensorDataset> &runs, const QStringList &labels, SessionMode mode,
+                          const ColumnStorageOptions &storage, SensorDataset &session) {
+    session = SensorDataset();
+    const int k = int(runs.size());
+    const bool overlay = (mode == SessionMode::Overlay);
+
+    // В Overlay время каждого прогона - от его первой строки
+    QVector<double> shift(k, 0.0);
+    qsizetype total = 0;
+    for (int r = 0; r < k; ++r) {
+        total += runs[r].time.size();
+        if (overlay && !runs[r].time.isEmpty()) shift[r] = -runs[r].time.first();
+    }
+
+    // 1. k-путевое слияние осей времени. Строка сессии помнит прогон и строку в нем,
+    // строка прогона - свое место в сессии (границы датчиков)
+    session.time.resize(total);
+    QVector<int> rowRun(total);
+    QVector<qsizetype> rowSource(total);
+    QVector<QVector<qsizetype>> position(k);
+    for (int r = 0; r < k; ++r) position[r].resize(runs[r].time.size());
+
+    using Head = std::pair<double, int>; // время текущей строки, прогон
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+    QVector<qsizetype> next(k, 0);
+    for (int r = 0; r < k; ++r) {
+        if (!runs[r].time.isEmpty()) heap.push({runs[r].time.first() + shift[r], r});
+    }
+
+    qsizetype out = 0;
+    while (!heap.empty()) {
+        const int r = heap.top().second;
+        heap.pop();
+        const QVector<double> &t = runs[r].time;
+        qsizetype &row = next[r];
+        // Пока прогон не пересекается с остальными, строки идут подряд без кучи:
+        // склейка последовательных файлов - линейная
+        do {
+            session.time[out] = t[row] + shift[r];
+            rowRun[out] = r;
+            rowSource[out] = row;
+            position[r][row] = out;
+            ++out;
+            ++row;
+        } while (row < t.size() && (heap.empty() || Head(t[row] + shift[r], r) < heap.top()));
+        if (row < t.size()) heap.push({t[row] + shift[r], r});
+    }
+
+    // 2. Датчики сессии: в Concatenate один на id S<n>, в Overlay - свой на каждый прогон
+    QMap<int, Output> byId;
+    for (int r = 0; r < k; ++r) {
+        const QVector<Sensor> &sensors = runs[r].sensors;
+        for (int si = 0; si < sensors.size(); ++si) {
+            const Sensor &s = sensors[si];
+            const int id = overlay ? s.id + r * kOverlayIdStride : s.id;
+            Output &o = byId[id];
+            if (o.sources.isEmpty()) {
+                o.id = id;
+                o.name = overlay ? QString("%1 [%2]").arg(s.name, labels.value(r, QString::number(r + 1))) : s.name;
+            }
+            o.sources.append({r, si});
+            if (s.isEmpty()) continue;
+
+            const qsizetype first = position[r][s.offset];
+            const qsizetype last = position[r][s.offset + s.size() - 1] + 1;
+            if (o.end == 0) {
+                o.offset = first;
+                o.end = last;
+            } else {
+                o.offset = std::min(o.offset, first);
+                o.end = std::max(o.end, last);
+            }
+        }
+    }
+    const QVector<Output> outputs = byId.values();
+
+    qint64 columnBytes = 0;
+    for (const Output &o : outputs) columnBytes += qint64(o.end - o.offset) * 2 * qint64(sizeof(RawSample));
+
+    // Колонка датчика тянется и через строки остальных прогонов, что легли между его
+    // строками, - пропусками. Если пропуски раздувают колонки больше kMaxOverlayPadding
+    // раз, колонки сжимаются: в упакованном кадре пропуск - код 0 шириной в поле разностей
+    // (несколько бит вместо sizeof(RawSample)). Лимит памяти тогда меряется по самим отсчетам
+    ColumnStorageOptions sessionStorage = storage;
+    qint64 storageBytes = columnBytes;
+    if (overlay) {
+        qint64 sampleBytes = 0;
+        for (const SensorDataset &run : runs) {
+            for (const Sensor &s : run.sensors) sampleBytes += qint64(s.size()) * 2 * qint64(sizeof(RawSample));
+        }
+        if (columnBytes > kMaxOverlayPadding * sampleBytes) {
+            qInfo() << "Overlay columns padded" << double(columnBytes) / double(sampleBytes)
+                    << "x with gaps, compressing them";
+            sessionStorage.compress = true;
+            storageBytes = sampleBytes;
+        }
+    }
+    if (!ChunkStore::forColumns(storageBytes, sessionStorage, session.store)) return false;
+
+    // 3. Колонки - параллельно по датчикам; строки сессии идут по возрастанию,
+    // поэтому и внутри каждого прогона курсоры источников только двигаются вперед
+    session.sensors.resize(outputs.size());
+    Sensor *result = session.sensors.data();
+    QVector<int> order(outputs.size());
+    std::iota(order.begin(), order.end(), 0);
+    const QSharedPointer<ChunkStore> store = session.store;
+
+    QtConcurrent::blockingMap(order, [&](int n) {
+        const Output &o = outputs[n];
+        Sensor &s = result[n];
+        s.id = o.id;
+        s.name = o.name;
+        s.offset = o.offset;
+        if (store) {
+            s.rawA = SampleColumn(store);
+            s.rawB = SampleColumn(store);
+        }
+        s.rawA.reserve(o.end - o.offset);
+        s.rawB.reserve(o.end - o.offset);
+
+        QVector<int> sensorOfRun(k, -1);
+        QVector<SampleColumn::Cursor> rawA(k), rawB(k);
+        for (const Source &src : o.sources) {
+            const Sensor &from = runs[src.run].sensors[src.sensor];
+            sensorOfRun[src.run] = src.sensor;
+            rawA[src.run] = SampleColumn::Cursor(from.rawA);
+            rawB[src.run] = SampleColumn::Cursor(from.rawB);
+            // Детекторы - по порядку прогонов; при пересечении прогонов по времени
+            // серии на стыках приблизительные
+            s.monitorA.merge(from.monitorA);
+            s.monitorB.merge(from.monitorB);
+        }
+
+        for (qsizetype row = o.offset; row < o.end; ++row) {
+            const int run = rowRun[row];
+            const int si = sensorOfRun[run];
+            RawSample a = gapSample();
+            RawSample b = gapSample();
+            if (si >= 0) {
+                const Sensor &from = runs[run].sensors[si];
+                const qsizetype i = rowSource[row] - from.offset;
+                if (i >= 0 && i < from.size()) {
+                    a = rawA[run][i];
+                    b = rawB[run][i];
+                }
+            }
+            s.rawA.append(a);
+            s.rawB.append(b);
+        }
+        s.rawA.squeeze();
+        s.rawB.squeeze();
+    });
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef SESSIONMERGER_H
+#define SESSIONMERGER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "sensordata.h"
+
+// Как сводить прогоны в одну сессию
+enum class SessionMode {
+    Concatenate, // один датчик S<n> на всю сессию, строки прогонов слиты по абсолютному времени
+    Overlay      // прогоны рядом: время каждого от его начала, у датчиков свои id и метка прогона
+};
+
+// Сведение нескольких загруженных прогонов в один набор без повторного чтения файлов.
+//
+// Строки всех прогонов сливаются k-путевым слиянием по времени (куча по текущей
+// строке каждого прогона, при равном времени раньше идет прогон с меньшим номером)
+// в общую ось; колонки датчиков собираются параллельно по датчикам, каждая
+// исходная колонка читается курсором один раз. Статистика, пирамиды и калибровка
+// результата не считаются - это дело вызывающего (DatasetLoader::loadSession).
+//
+// В Overlay прогоны идут от общего нуля и чередуются по строкам оси, поэтому колонка
+// датчика прогона занимает почти всю сессию, а чужие строки в ней - пропуски: при k
+// прогонах одной длины колонки (и пирамиды) в k раз больше самих отсчетов. Такие
+// колонки сжимаются (см. kMaxOverlayPadding), на диске они остаются полного размера.
+class SessionMerger
+{
+public:
+    // В режиме Overlay id датчика прогона r - id + r * kOverlayIdStride
+    static constexpr int kOverlayIdStride = 100000;
+    // Во сколько раз пропуски Overlay могут раздуть колонки, прежде чем те сжимаются
+    static constexpr qint64 kMaxOverlayPadding = 2;
+
+    // labels - подписи прогонов (имена файлов) для режима Overlay
+    static bool merge(const QVector<SensorDataset> &runs, const QStringList &labels, SessionMode mode,
+                      const ColumnStorageOptions &storage, SensorDataset &session);
+};
+
+#endif // SESSIONMERGER_H
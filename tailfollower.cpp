@@ -0,0 +1,55 @@
+#include "tailfollower.h"
+
+#include <QFile>
+#include <QDebug>
+
+bool TailFollower::start(const QString &txtPath, qint64 offset) {
+    stop();
+
+    QFile file(txtPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot follow file:" << txtPath;
+        return false;
+    }
+
+    // Колонки берем из заголовка в начале файла
+    const QByteArray head = file.read(qMin(offset, kHeaderProbeBytes));
+    qsizetype bodyOffset = 0;
+    if (!TxtParser::parseHeader(head.constData(), head.constData() + head.size(), m_layout, bodyOffset)) {
+        qWarning() << "Cannot follow file without header:" << txtPath;
+        return false;
+    }
+
+    m_path = txtPath;
+    m_offset = offset;
+    qInfo() << "Following" << txtPath << "from byte" << offset;
+    return true;
+}
+
+void TailFollower::stop() {
+    m_path.clear();
+    m_offset = 0;
+    m_layout = TxtParser::Layout();
+}
+
+TailFollower::Status TailFollower::readAppended(SensorDataset &tail) {
+    if (!isActive()) return Status::Idle;
+
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) return Status::Idle; // файл мог быть временно занят
+
+    const qint64 size = file.size();
+    if (size < m_offset) return Status::Reset;
+    if (size == m_offset || !file.seek(m_offset)) return Status::Idle;
+
+    const QByteArray bytes = file.read(qMin(size - m_offset, kMaxReadBytes));
+    const char *begin = bytes.constData();
+    const char *end = TxtParser::completeLinesEnd(begin, begin + bytes.size());
+    if (end == begin) return Status::Idle; // строка еще дописывается
+
+    tail = SensorDataset();
+    tail.sensors = TxtParser::makeSensors(m_layout);
+    TxtParser::parseRows(begin, end, m_layout, tail);
+    m_offset += end - begin;
+    return tail.time.isEmpty() ? Status::Idle : Status::Appended;
+}
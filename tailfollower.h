@@ -0,0 +1,43 @@
+#ifndef TAILFOLLOWER_H
+#define TAILFOLLOWER_H
+
+#include <QString>
+
+#include "sensordata.h"
+#include "txtparser.h"
+
+// Слежение за results.txt, который еще дописывается установкой.
+// Помнит смещение конца последней разобранной целой строки и при каждом
+// readAppended() разбирает только дописанные после него байты.
+// Частоту опроса задает владелец (модель - таймером), так что поток строк
+// любой плотности превращается в одно обновление за тик. readAppended не
+// трогает ничего, кроме самого объекта, поэтому его можно звать в пуле на копии.
+class TailFollower
+{
+public:
+    enum class Status {
+        Idle,     // новых целых строк нет
+        Appended, // tail заполнен
+        Reset     // файл укоротился (перезаписан) - нужен полный импорт
+    };
+
+    // offset - сколько байт уже разобрано (TxtParser::parseFile, parsedBytes)
+    bool start(const QString &txtPath, qint64 offset);
+    void stop();
+    bool isActive() const { return !m_path.isEmpty(); }
+    const QString &path() const { return m_path; }
+
+    Status readAppended(SensorDataset &tail);
+
+private:
+    static constexpr qint64 kHeaderProbeBytes = 1 << 20;
+    // За тик: разбор идет в пуле, но дописывание в набор - на GUI-потоке, поэтому
+    // после паузы файл догоняется порциями, а не одним большим хвостом
+    static constexpr qint64 kMaxReadBytes = 1 << 20;
+
+    QString m_path;
+    qint64 m_offset = 0;
+    TxtParser::Layout m_layout;
+};
+
+#endif // TAILFOLLOWER_H
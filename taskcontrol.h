@@ -0,0 +1,53 @@
+#ifndef TASKCONTROL_H
+#define TASKCONTROL_H
+
+#include <QtGlobal>
+
+#include <atomic>
+
+// Общее состояние фоновой операции: рабочий поток пишет прогресс,
+// GUI-поток читает его по таймеру и может запросить отмену.
+//
+// У части операции может быть свой контроль с parent: ее total и done
+// добавляются к родительским, отмена родителя видна в ней сразу.
+class TaskControl
+{
+public:
+    explicit TaskControl(TaskControl *parent = nullptr) : m_parent(parent) {}
+
+    void reset() {
+        m_done.store(0, std::memory_order_relaxed);
+        m_total.store(0, std::memory_order_relaxed);
+        m_canceled.store(false, std::memory_order_relaxed);
+    }
+
+    void setTotal(qint64 total) {
+        const qint64 old = m_total.exchange(total, std::memory_order_relaxed);
+        if (m_parent) m_parent->addTotal(total - old);
+    }
+    void addDone(qint64 delta) {
+        m_done.fetch_add(delta, std::memory_order_relaxed);
+        if (m_parent) m_parent->addDone(delta);
+    }
+
+    qint64 done() const { return m_done.load(std::memory_order_relaxed); }
+    qint64 total() const { return m_total.load(std::memory_order_relaxed); }
+
+    void cancel() { m_canceled.store(true, std::memory_order_relaxed); }
+    bool isCanceled() const {
+        return m_canceled.load(std::memory_order_relaxed) || (m_parent && m_parent->isCanceled());
+    }
+
+private:
+    void addTotal(qint64 delta) {
+        m_total.fetch_add(delta, std::memory_order_relaxed);
+        if (m_parent) m_parent->addTotal(delta);
+    }
+
+    TaskControl *m_parent = nullptr;
+    std::atomic<qint64> m_done{0};
+    std::atomic<qint64> m_total{0};
+    std::atomic<bool> m_canceled{false};
+};
+
+#endif // TASKCONTROL_H
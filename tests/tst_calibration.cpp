@@ -0,0 +1,123 @@
+#include <QtTest>
+
+#include "calibration.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+// columnStats: суммы по полосам и блокам с компенсацией против наивной суммы в long double
+class TestCalibration : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void compensatedSum_data();
+    void compensatedSum();
+    void gapsAndExtremes();
+    void floatColumn();
+};
+
+namespace {
+
+enum class Values { NearOffset, MixedMagnitudes, Integers };
+
+QVector<double> makeValues(Values kind, qsizetype n, quint64 seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    QVector<double> x(n);
+    for (double &v : x) {
+        switch (kind) {
+        case Values::NearOffset: v = 1e6 + u(rng) * 100.0; break;
+        case Values::MixedMagnitudes: v = (u(rng) < 0.5 ? -1.0 : 1.0) * std::pow(10.0, u(rng) * 12.0); break;
+        case Values::Integers: v = 1e9 + std::floor(u(rng) * 4096.0); break;
+        }
+    }
+    return x;
+}
+
+} // namespace
+
+void TestCalibration::compensatedSum_data() {
+    QTest::addColumn<int>("kind");
+    QTest::addColumn<qsizetype>("count");
+
+    // Размеры вокруг полос (8) и блоков (kBlockSize) плюс длинный ряд
+    const qsizetype block = CalibrationEngine::kBlockSize;
+    const QVector<qsizetype> sizes = {1, 7, 8, 9, block - 1, block, block + 1, 3 * block + 5, 1000003};
+    const QStringList names = {"offset", "mixed", "integers"};
+    for (int kind = 0; kind < names.size(); ++kind) {
+        for (qsizetype n : sizes)
+            QTest::addRow("%s/%lld", qPrintable(names[kind]), qlonglong(n)) << kind << n;
+    }
+}
+
+void TestCalibration::compensatedSum() {
+    if (std::numeric_limits<long double>::digits <= std::numeric_limits<double>::digits)
+        QSKIP("long double is not wider than double here: no reference");
+
+    QFETCH(int, kind);
+    QFETCH(qsizetype, count);
+    const QVector<double> x = makeValues(Values(kind), count, 42 + count);
+
+    long double reference = 0.0L;
+    long double magnitude = 0.0L;
+    for (double v : x) {
+        reference += v;
+        magnitude += std::fabs(v);
+    }
+
+    const ChannelStats stats = CalibrationEngine::columnStats(x.constData(), x.size());
+    QCOMPARE(stats.count, count);
+    // Ошибка - на уровне округления итоговой суммы, а не n округлений подряд
+    const long double error = std::fabs((long double)stats.sum - reference);
+    QVERIFY2(error <= 1e-15L * magnitude,
+             qPrintable(QString("error %1, sum of |x| %2").arg(double(error)).arg(double(magnitude))));
+}
+
+void TestCalibration::gapsAndExtremes() {
+    QVector<double> x = makeValues(Values::NearOffset, 10007, 7);
+    long double reference = 0.0L;
+    qsizetype valid = 0;
+    double lo = std::numeric_limits<double>::max();
+    double hi = std::numeric_limits<double>::lowest();
+    for (qsizetype i = 0; i < x.size(); ++i) {
+        if (i % 5 == 0 || i % 4097 == 1) {
+            x[i] = std::numeric_limits<double>::quiet_NaN();
+            continue;
+        }
+        reference += x[i];
+        ++valid;
+        lo = std::min(lo, x[i]);
+        hi = std::max(hi, x[i]);
+    }
+
+    const ChannelStats stats = CalibrationEngine::columnStats(x.constData(), x.size());
+    QCOMPARE(stats.count, valid);
+    QCOMPARE(stats.min, lo);
+    QCOMPARE(stats.max, hi);
+    QVERIFY(std::fabs((long double)stats.sum - reference) <= 1e-9L * std::fabs(reference));
+
+    // Одни пропуски: отсчетов нет, сумма 0
+    const QVector<double> gaps(100, std::numeric_limits<double>::quiet_NaN());
+    const ChannelStats empty = CalibrationEngine::columnStats(gaps.constData(), gaps.size());
+    QCOMPARE(empty.count, qsizetype(0));
+    QCOMPARE(empty.sum, 0.0);
+}
+
+void TestCalibration::floatColumn() {
+    // float32-колонка (SOLAR_RAW_FLOAT32): целые счетчики до 2^24 точны, сумма - в double
+    QVector<float> x(CalibrationEngine::kBlockSize * 3 + 11);
+    long double reference = 0.0L;
+    for (qsizetype i = 0; i < x.size(); ++i) {
+        x[i] = float(1000000 + (i * 7919) % 65536);
+        reference += x[i];
+    }
+    const ChannelStats stats = CalibrationEngine::columnStats(x.constData(), x.size());
+    QCOMPARE(stats.count, x.size());
+    QCOMPARE((long double)stats.sum, reference);
+}
+
+QTEST_APPLESS_MAIN(TestCalibration)
+
+#include "tst_calibration.moc"
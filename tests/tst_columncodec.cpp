@@ -0,0 +1,200 @@
+#include <QtTest>
+#include <QtEndian>
+
+#include "chunkstore.h"
+#include "columncodec.h"
+
+#include <cmath>
+#include <random>
+
+// ColumnCodec: сжатие и распаковка без потерь, выбор вида кадра, граничные ширины поля
+class TestColumnCodec : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void widestEncodedField();
+    void decodeWidth56();
+};
+
+namespace {
+
+constexpr qsizetype kFrame = ColumnCodec::kFrame;
+constexpr qsizetype kHeader = 3 + 8;  // вид, scale, width, base
+constexpr qsizetype kPadding = 8;
+const double kLimit = 1125899906842624.0; // 2^50 - предел целых в кадре
+
+bool sameSample(RawSample a, RawSample b) {
+    if (isGap(a) || isGap(b)) return isGap(a) && isGap(b);
+    return a == b && std::signbit(a) == std::signbit(b);
+}
+
+// Виды кадров блоба: 'p' - упакованный, 'r' - как есть; widths - ширины полей упакованных
+QString frameKinds(const QByteArray &blob, qsizetype count, QVector<int> *widths = nullptr) {
+    QString kinds;
+    qsizetype at = 0;
+    for (qsizetype i = 0; i < count; i += kFrame) {
+        const qsizetype n = std::min(kFrame, count - i);
+        if (blob.at(at) == 0) {
+            kinds += 'r';
+            at += 1 + n * qsizetype(sizeof(RawSample));
+        } else {
+            const int width = uchar(blob.at(at + 2));
+            kinds += 'p';
+            if (widths) widths->append(width);
+            at += kHeader + (n * width + 7) / 8;
+        }
+    }
+    return kinds;
+}
+
+// Медленно меняющийся счетчик: value/10^scale, шаг до ±3 единиц последнего знака
+QVector<RawSample> walk(qsizetype n, int scale, quint64 seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> step(-3, 3);
+    const double mul = std::pow(10.0, scale);
+    QVector<RawSample> data(n);
+    qint64 q = 123456;
+    for (RawSample &v : data) {
+        q += step(rng);
+        v = RawSample(double(q) / mul);
+    }
+    return data;
+}
+
+} // namespace
+
+void TestColumnCodec::roundTrip_data() {
+    QTest::addColumn<QVector<RawSample>>("data");
+    QTest::addColumn<QString>("kinds");
+
+    const bool wide = sizeof(RawSample) == sizeof(double);
+
+    QTest::newRow("empty") << QVector<RawSample>() << QString();
+    // Кадр из одного отсчета с заголовком длиннее самого отсчета - хранится как есть
+    QTest::newRow("single") << QVector<RawSample>{RawSample(42)} << QString("r");
+    QTest::newRow("frame + 1") << walk(kFrame + 1, 0, 1) << QString("pr");
+    QTest::newRow("chunk") << walk(ChunkStore::kChunkSamples, 0, 2) << QString(64, 'p');
+    // Хвостовой кадр короче kFrame: поле последнего отсчета читается из дополнения блоба
+    QTest::newRow("integers") << walk(3 * kFrame + 313, 0, 3) << QString("pppp");
+
+    // Пропуски: в начале кадра (до base), вперемешку и целый кадр пропусков (ширина 0)
+    QVector<RawSample> gaps = walk(3 * kFrame + 17, 0, 4);
+    for (qsizetype i = 0; i < 5; ++i) gaps[i] = gapSample();
+    for (qsizetype i = 7; i < kFrame; i += 11) gaps[i] = gapSample();
+    for (qsizetype i = kFrame; i < 2 * kFrame; ++i) gaps[i] = gapSample();
+    gaps.last() = gapSample();
+    QTest::newRow("gaps") << gaps << QString("pppp");
+    QTest::newRow("all gaps") << QVector<RawSample>(kFrame + 5, gapSample()) << QString("pp");
+
+    if (wide) {
+        // 10^6 - последний допустимый scale, дробь в седьмом знаке кадр уже не упаковывает
+        QTest::newRow("scale 6") << walk(2 * kFrame, 6, 5) << QString("pp");
+        QTest::newRow("scale 7") << walk(2 * kFrame, 7, 6) << QString("rr");
+
+        // Произвольные дроби и -0 (после округления стал бы +0) - кадры как есть.
+        // У float32 дробь часто округляется до десятичной, и такой кадр пакуется
+        std::mt19937_64 rng(7);
+        std::uniform_real_distribution<double> u(-1.0, 1.0);
+        QVector<RawSample> verbatim = walk(3 * kFrame, 0, 8);
+        for (qsizetype i = 0; i < kFrame; ++i) verbatim[i] = RawSample(u(rng));
+        verbatim[kFrame + 100] = RawSample(-0.0);
+        verbatim[2 * kFrame + 9] = gapSample();
+        QTest::newRow("verbatim") << verbatim << QString("rrp");
+
+        // Целое на пределе 2^50 уже не упаковывается, на единицу меньше - упаковывается
+        QVector<RawSample> limit = walk(2 * kFrame, 0, 9);
+        limit[3] = RawSample(kLimit);
+        limit[kFrame + 3] = RawSample(kLimit - 1);
+        QTest::newRow("integer limit") << limit << QString("rp");
+    }
+}
+
+void TestColumnCodec::roundTrip() {
+    QFETCH(QVector<RawSample>, data);
+    QFETCH(QString, kinds);
+
+    const qsizetype n = data.size();
+    const QByteArray blob = ColumnCodec::encode(data.constData(), n);
+    QCOMPARE(frameKinds(blob, n), kinds);
+
+    QVector<RawSample> out(n, RawSample(-1));
+    QVERIFY(ColumnCodec::decode(blob, out.data(), n));
+    for (qsizetype i = 0; i < n; ++i)
+        QVERIFY2(sameSample(out[i], data[i]), qPrintable(QString("sample %1: %2 != %3").arg(i).arg(out[i]).arg(data[i])));
+
+    // Без дополнения в конце блоб не принимается: распаковка читает поля по 8 байт
+    if (n > 0) {
+        QByteArray truncated = blob;
+        truncated.chop(1);
+        QVERIFY(!ColumnCodec::decode(truncated, out.data(), n));
+    }
+}
+
+void TestColumnCodec::widestEncodedField() {
+    if (sizeof(RawSample) != sizeof(double)) QSKIP("float32 samples cannot hold integers near 2^50");
+
+    // Скачки между ±(2^50 - 1) - самая широкая разность, которую кадр еще пакует (52 бита)
+    QVector<RawSample> data(kFrame + 100);
+    for (qsizetype i = 0; i < data.size(); ++i) data[i] = RawSample((i & 1) ? kLimit - 1 : -(kLimit - 1));
+
+    const QByteArray blob = ColumnCodec::encode(data.constData(), data.size());
+    QVector<int> widths;
+    QCOMPARE(frameKinds(blob, data.size(), &widths), QString("pp"));
+    QCOMPARE(widths, QVector<int>({52, 52}));
+
+    QVector<RawSample> out(data.size());
+    QVERIFY(ColumnCodec::decode(blob, out.data(), data.size()));
+    for (qsizetype i = 0; i < data.size(); ++i) QCOMPARE(out[i], data[i]);
+}
+
+void TestColumnCodec::decodeWidth56() {
+    // Кодер до ширины 56 не доходит, но распаковка обязана ее принимать: поле 56 бит
+    // со сдвигом до 7 - ровно одно 64-битное слово. Кадр собирается вручную
+    const qsizetype n = 37;
+    const int width = 56;
+    const qint64 base = -5;
+    std::mt19937_64 rng(11);
+
+    QVector<quint64> codes(n);
+    for (qsizetype k = 0; k < n; ++k) {
+        // Старший бит поля всегда взведен, изредка - пропуск (код 0)
+        codes[k] = (k % 9 == 4) ? 0 : ((rng() >> 8) | (quint64(1) << (width - 1)));
+    }
+
+    QByteArray blob(kHeader + (n * width + 7) / 8 + kPadding, '\0');
+    blob[0] = char(1);
+    blob[1] = char(0);
+    blob[2] = char(width);
+    qToLittleEndian<qint64>(base, blob.data() + 3);
+    uchar *bits = reinterpret_cast<uchar *>(blob.data() + kHeader);
+    for (qsizetype k = 0; k < n; ++k) {
+        for (int b = 0; b < width; ++b) {
+            const quint64 bit = quint64(k) * width + b;
+            if ((codes[k] >> b) & 1) bits[bit >> 3] |= uchar(1u << (bit & 7));
+        }
+    }
+
+    QVector<RawSample> out(n);
+    QVERIFY(ColumnCodec::decode(blob, out.data(), n));
+    qint64 acc = base;
+    for (qsizetype k = 0; k < n; ++k) {
+        if (codes[k] == 0) {
+            QVERIFY(isGap(out[k]));
+            continue;
+        }
+        const quint64 z = codes[k] - 1;
+        acc += qint64(z >> 1) ^ -qint64(z & 1);
+        QCOMPARE(out[k], RawSample(double(acc)));
+    }
+
+    // Ширина больше 56 не читается одним словом - такой кадр отвергается
+    blob[2] = char(width + 1);
+    QVERIFY(!ColumnCodec::decode(blob, out.data(), n));
+}
+
+QTEST_APPLESS_MAIN(TestColumnCodec)
+
+#include "tst_columncodec.moc"
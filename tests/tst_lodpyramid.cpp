@@ -0,0 +1,117 @@
+#include <QtTest>
+
+#include "lodpyramid.h"
+
+#include <random>
+
+// LodPyramid::range против прямого прохода по отсчетам
+class TestLodPyramid : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rangeMatchesScan_data();
+    void rangeMatchesScan();
+    void extendMatchesBuild();
+};
+
+namespace {
+
+// Колонка со ступенями, повторами (для проверки ничьих) и пропусками
+SampleColumn makeColumn(qsizetype n, bool paged, quint64 seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> value(0, 999);
+    std::uniform_int_distribution<int> gap(0, 19);
+    SampleColumn column = paged ? SampleColumn(ChunkStore::createCompressed()) : SampleColumn();
+    for (qsizetype i = 0; i < n; ++i) {
+        if (gap(rng) == 0) column.append(gapSample());
+        else column.append(RawSample(value(rng) / 10));
+    }
+    return column;
+}
+
+// Первые по индексу min и max на [from, to) - как у пирамиды при равных значениях
+LodPyramid::Bucket linearScan(const SampleColumn &column, qsizetype from, qsizetype to) {
+    LodPyramid::Bucket b;
+    for (qsizetype i = from; i < to; ++i) {
+        const RawSample v = column[i];
+        if (isGap(v)) continue;
+        if (b.minIndex == LodPyramid::kNoIndex) {
+            b.minIndex = b.maxIndex = quint32(i);
+            continue;
+        }
+        if (v < column[b.minIndex]) b.minIndex = quint32(i);
+        if (v > column[b.maxIndex]) b.maxIndex = quint32(i);
+    }
+    return b;
+}
+
+} // namespace
+
+void TestLodPyramid::rangeMatchesScan_data() {
+    QTest::addColumn<qsizetype>("count");
+    QTest::addColumn<bool>("paged");
+
+    QTest::newRow("short") << qsizetype(50) << false;
+    QTest::newRow("one level") << qsizetype(LodPyramid::kBaseBucket * 2 + 3) << false;
+    QTest::newRow("memory") << qsizetype(100003) << false;
+    // Несколько кусков хранилища: края и корзины на стыках кусков
+    QTest::newRow("paged") << qsizetype(ChunkStore::kChunkSamples * 3 + 777) << true;
+}
+
+void TestLodPyramid::rangeMatchesScan() {
+    QFETCH(qsizetype, count);
+    QFETCH(bool, paged);
+
+    const SampleColumn column = makeColumn(count, paged, 1234 + count);
+    LodPyramid pyramid;
+    pyramid.build(column, column.size());
+
+    std::mt19937_64 rng(99);
+    std::uniform_int_distribution<qsizetype> pos(0, count);
+    for (int k = 0; k < 400; ++k) {
+        qsizetype from = pos(rng), to = pos(rng);
+        if (from > to) std::swap(from, to);
+        // Каждый четвертый интервал - короткий, около границ корзин
+        if (k % 4 == 0) to = std::min(count, from + qsizetype(k % 200));
+
+        const LodPyramid::Bucket expected = linearScan(column, from, to);
+        const LodPyramid::Bucket actual = pyramid.range(column, from, to);
+        QVERIFY2(actual.minIndex == expected.minIndex && actual.maxIndex == expected.maxIndex,
+                 qPrintable(QString("[%1, %2): min %3/%4, max %5/%6")
+                                .arg(from).arg(to)
+                                .arg(actual.minIndex).arg(expected.minIndex)
+                                .arg(actual.maxIndex).arg(expected.maxIndex)));
+    }
+}
+
+void TestLodPyramid::extendMatchesBuild() {
+    // Дописывание хвостами (слежение) дает ту же пирамиду, что сборка целиком
+    const qsizetype count = 50000;
+    const SampleColumn column = makeColumn(count, false, 5);
+    LodPyramid grown;
+    qsizetype size = 0;
+    for (qsizetype step : {100, 1, 63, 64, 4096, 777, 20000}) {
+        const qsizetype next = std::min(count, size + step);
+        grown.extend(column, size, next);
+        size = next;
+    }
+    grown.extend(column, size, count);
+
+    LodPyramid built;
+    built.build(column, count);
+    QCOMPARE(grown.levels().size(), built.levels().size());
+    for (qsizetype l = 0; l < built.levels().size(); ++l) {
+        const QVector<LodPyramid::Bucket> &a = grown.levels().at(l);
+        const QVector<LodPyramid::Bucket> &b = built.levels().at(l);
+        QCOMPARE(a.size(), b.size());
+        for (qsizetype i = 0; i < a.size(); ++i) {
+            QCOMPARE(a[i].minIndex, b[i].minIndex);
+            QCOMPARE(a[i].maxIndex, b[i].maxIndex);
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(TestLodPyramid)
+
+#include "tst_lodpyramid.moc"
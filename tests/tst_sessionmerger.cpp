@@ -0,0 +1,160 @@
+#include <QtTest>
+
+#include "sessionmerger.h"
+
+#include <algorithm>
+#include <random>
+
+// SessionMerger::merge против сортировки всех строк прогонов по (время, прогон)
+class TestSessionMerger : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesSortMerge_data();
+    void matchesSortMerge();
+};
+
+namespace {
+
+enum class Layout {
+    Sequential,  // прогоны друг за другом: слияние идет целыми кусками без кучи
+    Interleaved, // прогоны пересекаются по времени
+    Ties,        // одинаковое время в разных прогонах и внутри прогона
+    EmptyRun     // средний прогон без строк
+};
+
+bool sameSample(RawSample a, RawSample b) {
+    return (isGap(a) && isGap(b)) || a == b;
+}
+
+// Прогон: время по неубыванию (шаг 0 - повтор), у каждого датчика свое начало,
+// длина и пропуски; датчик id 3 есть только в нечетных прогонах
+SensorDataset makeRun(int index, double t0, qsizetype rows, int maxStep, quint64 seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> step(0, maxStep);
+    std::uniform_int_distribution<int> value(0, 999);
+    std::uniform_int_distribution<int> gap(0, 9);
+
+    SensorDataset run;
+    double t = t0;
+    for (qsizetype i = 0; i < rows; ++i) {
+        run.time.append(t);
+        t += step(rng);
+    }
+    if (rows == 0) return run;
+
+    for (int id : {1, 2, 3}) {
+        if (id == 3 && index % 2 == 0) continue;
+        Sensor s;
+        s.id = id;
+        s.name = QString("S%1").arg(id);
+        s.offset = std::uniform_int_distribution<qsizetype>(0, rows / 4)(rng);
+        const qsizetype size = std::uniform_int_distribution<qsizetype>(rows / 2, rows - s.offset)(rng);
+        for (qsizetype i = 0; i < size; ++i) {
+            s.rawA.append(gap(rng) == 0 ? gapSample() : RawSample(value(rng)));
+            s.rawB.append(RawSample(value(rng)));
+        }
+        run.sensors.append(s);
+    }
+    return run;
+}
+
+QVector<SensorDataset> makeRuns(Layout layout) {
+    QVector<SensorDataset> runs;
+    for (int r = 0; r < 4; ++r) {
+        const quint64 seed = 100 + r;
+        switch (layout) {
+        case Layout::Sequential: runs.append(makeRun(r, 1000.0 * r, 300, 3, seed)); break;
+        case Layout::Interleaved: runs.append(makeRun(r, 7.0 * r, 500, 4, seed)); break;
+        case Layout::Ties: runs.append(makeRun(r, 0.0, 400, 1, seed)); break;
+        case Layout::EmptyRun: runs.append(makeRun(r, 5.0 * r, r == 1 ? 0 : 300, 2, seed)); break;
+        }
+    }
+    return runs;
+}
+
+} // namespace
+
+void TestSessionMerger::matchesSortMerge_data() {
+    QTest::addColumn<int>("layout");
+    QTest::addColumn<bool>("overlay");
+
+    const QList<QPair<const char *, Layout>> layouts = {{"sequential", Layout::Sequential},
+                                                        {"interleaved", Layout::Interleaved},
+                                                        {"ties", Layout::Ties},
+                                                        {"empty run", Layout::EmptyRun}};
+    for (const auto &l : layouts) {
+        QTest::newRow(QByteArray(l.first) + " concatenate") << int(l.second) << false;
+        QTest::newRow(QByteArray(l.first) + " overlay") << int(l.second) << true;
+    }
+}
+
+void TestSessionMerger::matchesSortMerge() {
+    QFETCH(int, layout);
+    QFETCH(bool, overlay);
+
+    const QVector<SensorDataset> runs = makeRuns(Layout(layout));
+    const QStringList labels = {"a", "b", "c", "d"};
+    SensorDataset session;
+    QVERIFY(SessionMerger::merge(runs, labels, overlay ? SessionMode::Overlay : SessionMode::Concatenate,
+                                 ColumnStorageOptions(), session));
+
+    // Эталон: все строки, устойчивая сортировка по (время, прогон) - при равном времени
+    // раньше прогон с меньшим номером, внутри прогона порядок строк сохраняется
+    struct Row {
+        double time;
+        int run;
+        qsizetype row;
+    };
+    QVector<Row> rows;
+    for (int r = 0; r < runs.size(); ++r) {
+        const QVector<double> &t = runs[r].time;
+        const double shift = (overlay && !t.isEmpty()) ? -t.first() : 0.0;
+        for (qsizetype i = 0; i < t.size(); ++i) rows.append({t[i] + shift, r, i});
+    }
+    std::stable_sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) {
+        return a.time < b.time || (a.time == b.time && a.run < b.run);
+    });
+
+    QCOMPARE(session.time.size(), rows.size());
+    QVector<QVector<qsizetype>> position(runs.size());
+    for (int r = 0; r < runs.size(); ++r) position[r].resize(runs[r].time.size());
+    for (qsizetype p = 0; p < rows.size(); ++p) {
+        QCOMPARE(session.time[p], rows[p].time);
+        position[rows[p].run][rows[p].row] = p;
+    }
+
+    // Каждый отсчет прогона - на своей строке сессии, других отсчетов в колонках нет
+    QHash<int, const Sensor *> byId;
+    for (const Sensor &s : session.sensors) byId.insert(s.id, &s);
+    QHash<int, qsizetype> expectedSamples;
+    qsizetype sourceCount = 0;
+    for (int r = 0; r < runs.size(); ++r) {
+        for (const Sensor &src : runs[r].sensors) {
+            ++sourceCount;
+            const int id = overlay ? src.id + r * SessionMerger::kOverlayIdStride : src.id;
+            const Sensor *s = byId.value(id);
+            QVERIFY2(s, qPrintable(QString("sensor %1 missing").arg(id)));
+            if (overlay) QCOMPARE(s->name, QString("%1 [%2]").arg(src.name, labels[r]));
+
+            for (qsizetype i = 0; i < src.size(); ++i) {
+                const qsizetype j = position[r][src.offset + i] - s->offset;
+                QVERIFY(j >= 0 && j < s->size());
+                QVERIFY(sameSample(s->rawA[j], src.rawA[i]));
+                QVERIFY(sameSample(s->rawB[j], src.rawB[i]));
+                if (!isGap(src.rawB[i])) ++expectedSamples[id];
+            }
+        }
+    }
+    QCOMPARE(session.sensors.size(), overlay ? sourceCount : qsizetype(3));
+    for (const Sensor &s : session.sensors) {
+        qsizetype samples = 0;
+        for (qsizetype j = 0; j < s.size(); ++j) samples += isGap(s.rawB[j]) ? 0 : 1;
+        QCOMPARE(samples, expectedSamples.value(s.id));
+    }
+}
+
+QTEST_APPLESS_MAIN(TestSessionMerger)
+
+#include "tst_sessionmerger.moc"
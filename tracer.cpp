@@ -0,0 +1,200 @@
+#include "tracer.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QThread>
+#include <QDebug>
+
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+namespace {
+
+QElapsedTimer &processClock() {
+    static QElapsedTimer clock = [] {
+        QElapsedTimer t;
+        t.start();
+        return t;
+    }();
+    return clock;
+}
+
+QJsonObject toJson(const TraceEvent &e) {
+    QJsonObject args;
+    if (e.bytes >= 0) args["bytes"] = e.bytes;
+    if (e.rows >= 0) args["rows"] = e.rows;
+    args["memory_mb"] = e.memoryBytes / 1048576.0;
+    args["peak_mb"] = e.peakBytes / 1048576.0;
+    args["peak_growth_mb"] = e.peakGrowth / 1048576.0;
+
+    QJsonObject o;
+    o["name"] = QString::fromLatin1(e.name);
+    o["cat"] = QString::fromLatin1(e.category);
+    o["ph"] = "X";
+    o["ts"] = e.startUs;
+    o["dur"] = e.durationUs;
+    o["pid"] = 1;
+    o["tid"] = e.thread;
+    o["args"] = args;
+    return o;
+}
+
+QJsonObject metadata(const char *name, int tid, const QString &value) {
+    QJsonObject o;
+    o["name"] = name;
+    o["ph"] = "M";
+    o["pid"] = 1;
+    o["tid"] = tid;
+    o["args"] = QJsonObject{{"name", value}};
+    return o;
+}
+
+} // namespace
+
+Tracer &Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+qint64 Tracer::nowUs() {
+    return processClock().nsecsElapsed() / 1000;
+}
+
+qint64 Tracer::memoryBytes() {
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return qint64(pmc.WorkingSetSize);
+    return 0;
+#elif defined(Q_OS_LINUX)
+    // Второе поле statm - резидентные страницы
+    long pages = 0;
+    if (FILE *f = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(f, "%*ld %ld", &pages) != 1) pages = 0;
+        std::fclose(f);
+    }
+    return qint64(pages) * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+qint64 Tracer::peakMemoryBytes() {
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return qint64(pmc.PeakWorkingSetSize);
+    return 0;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(Q_OS_DARWIN)
+    return qint64(usage.ru_maxrss);        // байты
+#else
+    return qint64(usage.ru_maxrss) * 1024; // килобайты
+#endif
+#else
+    return 0;
+#endif
+}
+
+int Tracer::threadIndex() {
+    // GUI-поток - 0, остальные нумеруются по первому появлению
+    QThread *current = QThread::currentThread();
+    if (QCoreApplication::instance() && current == QCoreApplication::instance()->thread()) return 0;
+    const quintptr id = reinterpret_cast<quintptr>(current);
+    auto it = m_threads.constFind(id);
+    if (it != m_threads.constEnd()) return it.value();
+    const int index = m_threads.size() + 1;
+    m_threads.insert(id, index);
+    return index;
+}
+
+void Tracer::record(TraceEvent event) {
+    QMutexLocker lock(&m_mutex);
+    event.thread = threadIndex();
+    if (m_events.size() >= kMaxEvents) m_events.remove(0, kMaxEvents / 4);
+    m_events.append(std::move(event));
+}
+
+void Tracer::clear() {
+    QMutexLocker lock(&m_mutex);
+    m_events.clear();
+}
+
+QVector<TraceEvent> Tracer::events() const {
+    QMutexLocker lock(&m_mutex);
+    return m_events;
+}
+
+QVector<TraceEvent> Tracer::latestPerStage() const {
+    QVector<TraceEvent> latest;
+    {
+        QMutexLocker lock(&m_mutex);
+        QHash<QByteArray, qsizetype> index;
+        for (const TraceEvent &e : m_events) {
+            auto it = index.find(e.name);
+            if (it == index.end()) {
+                index.insert(e.name, latest.size());
+                latest.append(e);
+            } else if (e.startUs >= latest[*it].startUs) {
+                latest[*it] = e;
+            }
+        }
+    }
+    std::sort(latest.begin(), latest.end(),
+              [](const TraceEvent &a, const TraceEvent &b) { return a.startUs < b.startUs; });
+    return latest;
+}
+
+bool Tracer::writeChromeTrace(const QString &path) const {
+    const QVector<TraceEvent> all = events();
+
+    QJsonArray list;
+    list.append(metadata("process_name", 0, QCoreApplication::applicationName()));
+    list.append(metadata("thread_name", 0, QStringLiteral("GUI")));
+    int maxThread = 0;
+    for (const TraceEvent &e : all) maxThread = qMax(maxThread, e.thread);
+    for (int t = 1; t <= maxThread; ++t) list.append(metadata("thread_name", t, QStringLiteral("worker %1").arg(t)));
+    for (const TraceEvent &e : all) list.append(toJson(e));
+
+    QJsonObject root;
+    root["traceEvents"] = list;
+    root["displayTimeUnit"] = "ms";
+
+    QFile file(path);
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+        qWarning() << "Failed to save trace:" << path;
+        return false;
+    }
+    qInfo() << "Exported trace to:" << path << "(" << all.size() << "events )";
+    return true;
+}
+
+TraceScope::TraceScope(const char *name, const char *category) {
+    m_event.name = QByteArray(name);
+    m_event.category = QByteArray(category);
+    m_event.peakBytes = Tracer::peakMemoryBytes();
+    m_event.startUs = Tracer::nowUs();
+}
+
+TraceScope::~TraceScope() {
+    m_event.durationUs = Tracer::nowUs() - m_event.startUs;
+    const qint64 peakBefore = m_event.peakBytes;
+    m_event.peakBytes = Tracer::peakMemoryBytes();
+    m_event.peakGrowth = m_event.peakBytes - peakBefore;
+    m_event.memoryBytes = Tracer::memoryBytes();
+    Tracer::instance().record(std::move(m_event));
+}
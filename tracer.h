@@ -0,0 +1,79 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+// Замер одной стадии конвейера. Время - в мкс от запуска процесса.
+// Память - рабочий набор процесса: текущий и пиковый в конце стадии,
+// peakGrowth - насколько стадия подняла пик (0, если пик был выше еще до нее).
+struct TraceEvent {
+    QByteArray name;
+    QByteArray category;
+    qint64 startUs = 0;
+    qint64 durationUs = 0;
+    int thread = 0;
+    qint64 bytes = -1;  // -1 - не относится к стадии
+    qint64 rows = -1;
+    qint64 memoryBytes = 0;
+    qint64 peakBytes = 0;
+    qint64 peakGrowth = 0;
+};
+
+// Встроенная трассировка стадий: чтение, разбор, модель, калибровка, экспорт,
+// заполнение серий, перерисовка. Событий немного (единицы на операцию),
+// поэтому запись всегда включена. Выгружается в формат Chrome trace-event
+// (chrome://tracing, Perfetto), последние замеры показывает оверлей в QML.
+class Tracer
+{
+public:
+    static Tracer &instance();
+
+    static qint64 nowUs();
+    static qint64 memoryBytes();
+    static qint64 peakMemoryBytes();
+
+    void record(TraceEvent event);
+    void clear();
+
+    QVector<TraceEvent> events() const;
+    // Последнее событие каждой стадии, по времени начала
+    QVector<TraceEvent> latestPerStage() const;
+
+    bool writeChromeTrace(const QString &path) const;
+
+private:
+    Tracer() = default;
+    int threadIndex(); // под m_mutex
+
+    static constexpr int kMaxEvents = 20000; // старые события вытесняются
+
+    mutable QMutex m_mutex;
+    QVector<TraceEvent> m_events;
+    QHash<quintptr, int> m_threads; // id потока -> короткий номер для trace-файла
+};
+
+// Замер области видимости: событие пишется в деструкторе.
+//   TraceScope trace("tokenize");
+//   ...
+//   trace.setRows(dataset.time.size());
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name, const char *category = "pipeline");
+    ~TraceScope();
+
+    void setBytes(qint64 bytes) { m_event.bytes = bytes; }
+    void setRows(qint64 rows) { m_event.rows = rows; }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    TraceEvent m_event;
+};
+
+#endif // TRACER_H
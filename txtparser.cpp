@@ -0,0 +1,433 @@
+#include "txtparser.h"
+#include "taskcontrol.h"
+#include "tracer.h"
+
+#include <QFile>
+#include <QHash>
+#include <QDebug>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline const char *findLineEnd(const char *p, const char *end) {
+    const void *eol = std::memchr(p, '\n', size_t(end - p));
+    return eol ? static_cast<const char *>(eol) : end;
+}
+
+} // namespace
+
+double TxtParser::parseNumber(const char *begin, const char *end) {
+    // Копируем токен на стек, заодно меняя десятичную запятую на точку
+    char buf[64];
+    const qsizetype len = end - begin;
+    if (len <= 0 || len >= qsizetype(sizeof(buf))) return 0.0;
+    for (qsizetype i = 0; i < len; ++i) buf[i] = (begin[i] == ',') ? '.' : begin[i];
+
+    const char *first = buf;
+    const char *last = buf + len;
+    if (*first == '+') ++first;
+
+    double value = 0.0;
+    const auto res = std::from_chars(first, last, value);
+    if (res.ec != std::errc() || res.ptr != last) return 0.0;
+    return value;
+}
+
+bool TxtParser::parseHeader(const char *begin, const char *end, Layout &layout, qsizetype &bodyOffset) {
+    const char *line = begin;
+    while (line < end) {
+        const char *eol = findLineEnd(line, end);
+        const QByteArray lower = QByteArray(line, eol - line).toLower();
+
+        if (lower.contains("time") && lower.contains("_a")) {
+            // Заголовок - одна строка, здесь регулярки не мешают
+            const QStringList headers = QString::fromUtf8(line, eol - line)
+                                            .split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+            QRegularExpression re("S(\\d+)_([AB])", QRegularExpression::CaseInsensitiveOption);
+            QHash<int, int> slotById;
+
+            layout.columns = QVector<Column>(headers.size());
+            layout.sensorIds.clear();
+
+            // Колонка 0 - всегда время
+            for (int i = 1; i < headers.size(); ++i) {
+                QRegularExpressionMatch match = re.match(headers[i].trimmed());
+                if (!match.hasMatch()) continue;
+
+                const int id = match.captured(1).toInt();
+                auto it = slotById.constFind(id);
+                int slot;
+                if (it == slotById.constEnd()) {
+                    slot = layout.sensorIds.size();
+                    slotById.insert(id, slot);
+                    layout.sensorIds.append(id);
+                } else {
+                    slot = it.value();
+                }
+                layout.columns[i].slot = slot;
+                layout.columns[i].channel = (match.captured(2).compare("A", Qt::CaseInsensitive) == 0) ? 0 : 1;
+            }
+
+            bodyOffset = ((eol < end) ? eol + 1 : end) - begin;
+            return true;
+        }
+        line = (eol < end) ? eol + 1 : end;
+    }
+    return false;
+}
+
+bool TxtParser::parseRows(const char *begin, const char *end, const Layout &layout, SensorDataset &out,
+                          TaskControl *control) {
+    const int columnCount = layout.columns.size();
+    const Column *columns = layout.columns.constData();
+    QVector<Sensor> &sensors = out.sensors;
+
+    // Номер строки, в которой датчик последний раз получил значение
+    QVector<qsizetype> lastRow(layout.sensorIds.size(), -1);
+
+    // Прогресс и отмену проверяем не на каждой строке
+    const qint64 reportEvery = 8192;
+    qint64 lineCount = 0;
+    const char *reported = begin;
+
+    const char *line = begin;
+    while (line < end) {
+        if (control && (lineCount % reportEvery) == 0 && lineCount > 0) {
+            control->addDone(line - reported);
+            reported = line;
+            if (control->isCanceled()) return false;
+        }
+
+        const char *eol = findLineEnd(line, end);
+        const char *p = line;
+        double time = 0.0;
+        int col = 0;
+        qsizetype row = -1; // строка заводится при первом значении датчика
+
+        while (true) {
+            while (p < eol && isSpace(*p)) ++p;
+            if (p >= eol) break;
+            const char *token = p;
+            while (p < eol && !isSpace(*p)) ++p;
+
+            if (col == 0) {
+                time = parseNumber(token, p);
+            } else if (col < columnCount && columns[col].slot >= 0) {
+                if (row < 0) {
+                    row = out.time.size();
+                    out.time.append(time);
+                    for (Sensor &s : sensors) {
+                        s.rawA.append(gapSample());
+                        s.rawB.append(gapSample());
+                    }
+                }
+
+                const Column &c = columns[col];
+                Sensor &s = sensors[c.slot];
+                // Первая колонка датчика в строке: второй канал по умолчанию 0
+                if (lastRow[c.slot] != row) {
+                    s.rawA.set(row, 0);
+                    s.rawB.set(row, 0);
+                    lastRow[c.slot] = row;
+                }
+                const RawSample val = RawSample(parseNumber(token, p));
+                if (c.channel == 0) s.rawA.set(row, val);
+                else s.rawB.set(row, val);
+            }
+            ++col;
+        }
+
+        // Строка собрана: детекторы каналов получают значение или пропуск (O(1) на канал)
+        if (row >= 0) {
+            for (Sensor &s : sensors) {
+                s.monitorA.add(s.rawA.constData()[row]);
+                s.monitorB.add(s.rawB.constData()[row]);
+            }
+        }
+
+        ++lineCount;
+        line = (eol < end) ? eol + 1 : end;
+    }
+
+    if (control) control->addDone(end - reported);
+    return true;
+}
+
+QVector<Sensor> TxtParser::makeSensors(const Layout &layout) {
+    QVector<Sensor> sensors(layout.sensorIds.size());
+    for (int i = 0; i < sensors.size(); ++i) {
+        sensors[i].id = layout.sensorIds[i];
+        sensors[i].name = QString("Sensor %1").arg(layout.sensorIds[i]);
+    }
+    return sensors;
+}
+
+void TxtParser::finalizeSensors(SensorDataset &dataset) {
+    QVector<Sensor> &sensors = dataset.sensors;
+    for (Sensor &s : sensors) {
+        // Края обрезаются до строк, где есть отсчет хотя бы одного канала
+        const SampleColumn &a = s.rawA;
+        const SampleColumn &b = s.rawB;
+        qsizetype first = 0;
+        qsizetype last = s.size();
+        while (first < last && isGap(a[first]) && isGap(b[first])) ++first;
+        while (last > first && isGap(a[last - 1]) && isGap(b[last - 1])) --last;
+
+        s.rawA.truncate(last);
+        s.rawB.truncate(last);
+        s.rawA.removeFirst(first);
+        s.rawB.removeFirst(first);
+        s.offset = first;
+        s.rawA.squeeze();
+        s.rawB.squeeze();
+    }
+
+    sensors.erase(std::remove_if(sensors.begin(), sensors.end(),
+                                 [](const Sensor &s) { return s.isEmpty(); }),
+                  sensors.end());
+    std::sort(sensors.begin(), sensors.end(), [](const Sensor &a, const Sensor &b) { return a.id < b.id; });
+}
+
+bool TxtParser::parseBuffer(const char *begin, const char *end, SensorDataset &dataset, int threadCount,
+                            TaskControl *control) {
+    Layout layout;
+    qsizetype bodyOffset = 0;
+    if (!parseHeader(begin, end, layout, bodyOffset)) return false;
+
+    const char *body = begin + bodyOffset;
+    if (control) control->setTotal(end - body);
+
+    SensorDataset result;
+    if (!parseBody(body, end, layout, result, threadCount, control)) return false;
+
+    finalizeSensors(result);
+    result.time.squeeze();
+    dataset = std::move(result);
+    return true;
+}
+
+bool TxtParser::parseBufferPaged(const char *begin, const char *end, SensorDataset &dataset,
+                                 const QSharedPointer<ChunkStore> &store, qint64 segmentBytes, int threadCount,
+                                 TaskControl *control) {
+    Layout layout;
+    qsizetype bodyOffset = 0;
+    if (!parseHeader(begin, end, layout, bodyOffset)) return false;
+
+    const char *body = begin + bodyOffset;
+    if (control) control->setTotal(end - body);
+
+    SensorDataset result;
+    result.store = store;
+    result.sensors = makeSensors(layout);
+    for (Sensor &s : result.sensors) {
+        s.rawA = SampleColumn(store);
+        s.rawB = SampleColumn(store);
+    }
+    QVector<int> slotIndexes(result.sensors.size());
+    std::iota(slotIndexes.begin(), slotIndexes.end(), 0);
+
+    // Сегмент разбирается как обычно (на всех ядрах), его колонки дописываются
+    // в колонки на диске, и память сегмента освобождается до следующего
+    segmentBytes = qMax<qint64>(segmentBytes, 1 << 20);
+    for (const char *from = body; from < end;) {
+        const char *cut = (end - from > segmentBytes) ? from + segmentBytes : end;
+        const char *eol = findLineEnd(cut, end);
+        const char *to = (cut < end && eol < end) ? eol + 1 : end;
+
+        SensorDataset segment;
+        if (!parseBody(from, to, layout, segment, threadCount, control)) return false;
+        from = to;
+
+        result.time.append(segment.time);
+        QtConcurrent::blockingMap(slotIndexes, [&result, &segment](int slot) {
+            Sensor &s = result.sensors[slot];
+            const Sensor &part = segment.sensors.at(slot);
+            s.rawA.append(part.rawA);
+            s.rawB.append(part.rawB);
+            s.monitorA.merge(part.monitorA);
+            s.monitorB.merge(part.monitorB);
+        });
+    }
+
+    if (store->hasError()) return false;
+
+    finalizeSensors(result);
+    result.time.squeeze();
+    dataset = std::move(result);
+    return true;
+}
+
+bool TxtParser::parseBody(const char *body, const char *end, const Layout &layout, SensorDataset &result,
+                          int threadCount, TaskControl *control) {
+    const QVector<Chunk> ranges = splitChunks(body, end, threadCount);
+
+    // Буферы кусков: у каждого свои колонки, общий только layout
+    struct ChunkResult {
+        Chunk range;
+        SensorDataset columns;
+    };
+    QVector<ChunkResult> chunks(ranges.size());
+    for (int i = 0; i < ranges.size(); ++i) {
+        chunks[i].range = ranges[i];
+        chunks[i].columns.sensors = makeSensors(layout);
+    }
+
+    auto parseChunk = [&layout, control](ChunkResult &chunk) {
+        // Оценка числа строк по длине первой строки, чтобы не перевыделять память
+        const qsizetype firstLineLen = findLineEnd(chunk.range.begin, chunk.range.end) - chunk.range.begin + 1;
+        if (firstLineLen > 1) {
+            const qsizetype estimate = (chunk.range.end - chunk.range.begin) / firstLineLen + 1;
+            chunk.columns.time.reserve(estimate);
+            for (Sensor &s : chunk.columns.sensors) {
+                s.rawA.reserve(estimate);
+                s.rawB.reserve(estimate);
+            }
+        }
+        parseRows(chunk.range.begin, chunk.range.end, layout, chunk.columns, control);
+    };
+
+    if (chunks.size() == 1) {
+        parseChunk(chunks.first());
+        if (control && control->isCanceled()) return false;
+        result = std::move(chunks.first().columns);
+        return true;
+    }
+
+    QtConcurrent::blockingMap(chunks, parseChunk);
+    if (control && control->isCanceled()) return false;
+
+    // Склейка: куски идут в порядке файла, т.е. по времени.
+    // Колонки плотные, поэтому строки всех датчиков совпадают.
+    qsizetype totalRows = 0;
+    for (const ChunkResult &chunk : std::as_const(chunks)) totalRows += chunk.columns.time.size();
+
+    result.time.reserve(totalRows);
+    for (const ChunkResult &chunk : std::as_const(chunks)) result.time.append(chunk.columns.time);
+
+    result.sensors = makeSensors(layout);
+    QVector<int> slotIndexes(result.sensors.size());
+    std::iota(slotIndexes.begin(), slotIndexes.end(), 0);
+    result.sensors.detach();
+
+    QtConcurrent::blockingMap(slotIndexes, [&result, &chunks, totalRows](int slot) {
+        Sensor &s = result.sensors[slot];
+        s.rawA.reserve(totalRows);
+        s.rawB.reserve(totalRows);
+        for (const ChunkResult &chunk : std::as_const(chunks)) {
+            const Sensor &part = chunk.columns.sensors.at(slot);
+            s.rawA.append(part.rawA);
+            s.rawB.append(part.rawB);
+            s.monitorA.merge(part.monitorA);
+            s.monitorB.merge(part.monitorB);
+        }
+    });
+    return true;
+}
+
+qint64 TxtParser::estimateColumnBytes(const char *begin, const char *end) {
+    Layout layout;
+    qsizetype bodyOffset = 0;
+    if (!parseHeader(begin, end, layout, bodyOffset)) return 0;
+
+    // Строки считаются по длине первой строки данных, колонки плотные: по значению A и B
+    // у каждого датчика заголовка в каждой строке
+    const char *body = begin + bodyOffset;
+    const qsizetype lineLen = findLineEnd(body, end) - body + 1;
+    if (lineLen <= 1) return 0;
+    const qint64 rows = (end - body) / lineLen + 1;
+    return rows * layout.sensorIds.size() * 2 * qint64(sizeof(RawSample));
+}
+
+QVector<TxtParser::Chunk> TxtParser::splitChunks(const char *begin, const char *end, int threadCount) {
+    if (threadCount <= 0) threadCount = QThread::idealThreadCount();
+
+    // Мелкие куски не окупают потоки
+    const qsizetype minChunkBytes = 1 << 20;
+    const qsizetype total = end - begin;
+    const qsizetype count = qBound<qsizetype>(1, total / minChunkBytes, qMax(1, threadCount));
+
+    QVector<Chunk> chunks;
+    chunks.reserve(count);
+    const char *from = begin;
+    for (qsizetype i = 1; i < count && from < end; ++i) {
+        const char *cut = begin + total * i / count;
+        if (cut < from) cut = from;
+        // Режем только по концу строки
+        const char *eol = findLineEnd(cut, end);
+        const char *to = (eol < end) ? eol + 1 : end;
+        chunks.append({ from, to });
+        from = to;
+    }
+    if (from < end || chunks.isEmpty()) chunks.append({ from, end });
+    return chunks;
+}
+
+const char *TxtParser::completeLinesEnd(const char *begin, const char *end) {
+    const char *p = end;
+    while (p > begin && p[-1] != '\n') --p;
+    return p;
+}
+
+bool TxtParser::parseFile(const QString &txtFilePath, SensorDataset &dataset, int threadCount,
+                          TaskControl *control, qint64 *parsedBytes, const ColumnStorageOptions &storage) {
+    QFile file(txtFilePath);
+    QByteArray content;
+    uchar *mapped = nullptr;
+    qint64 size = 0;
+    {
+        TraceScope trace("read");
+        if (!file.open(QIODevice::ReadOnly)) return false;
+
+        // Отображаем файл в память; если не получилось - читаем целиком.
+        // При отображении чтение с диска идет по ходу разбора (tokenize)
+        size = file.size();
+        mapped = (size > 0) ? file.map(0, size) : nullptr;
+        if (!mapped) content = file.readAll();
+        trace.setBytes(size);
+    }
+
+    const char *begin = mapped ? reinterpret_cast<const char *>(mapped) : content.constData();
+    const char *end = begin + (mapped ? size : content.size());
+
+    // Недописанную последнюю строку оставляем на следующее чтение
+    if (parsedBytes) {
+        end = completeLinesEnd(begin, end);
+        *parsedBytes = end - begin;
+    }
+
+    TraceScope trace("tokenize");
+    bool ok = false;
+    const bool useStore = storage.memoryLimit > 0 || storage.compress;
+    const qint64 columnBytes = useStore ? estimateColumnBytes(begin, end) : 0;
+    QSharedPointer<ChunkStore> store;
+    if (!ChunkStore::forColumns(columnBytes, storage, store)) return false;
+    if (store) {
+        // Колонки пишутся кусками в хранилище, в памяти - кэш кусков
+        // и колонки одного сегмента текста (четверть кэша)
+        if (!store->isCompressed()) {
+            qInfo() << "Out-of-core mode: ~" << columnBytes / 1048576 << "MB of columns, memory limit"
+                    << storage.memoryLimit / 1048576 << "MB";
+        }
+        ok = parseBufferPaged(begin, end, dataset, store, store->memoryLimit() / 4, threadCount, control);
+    } else {
+        ok = parseBuffer(begin, end, dataset, threadCount, control);
+    }
+    trace.setBytes(end - begin);
+    trace.setRows(dataset.time.size());
+
+    if (mapped) file.unmap(mapped);
+    file.close();
+    return ok;
+}
@@ -0,0 +1,88 @@
+#ifndef TXTPARSER_H
+#define TXTPARSER_H
+
+#include <QString>
+#include <QVector>
+
+#include "sensordata.h"
+
+class TaskControl;
+
+// Прямой разбор results.txt в колонки SensorDataset: один проход по байтам файла,
+// без промежуточного JSON, регулярных выражений и QString на каждое значение.
+// Большие файлы отображаются в память и разбираются на всех ядрах.
+class TxtParser
+{
+public:
+    // Колонка строки данных: слот датчика (-1 = колонка не нужна) и канал (0 = A, 1 = B)
+    struct Column {
+        int slot = -1;
+        int channel = 0;
+    };
+
+    struct Layout {
+        QVector<Column> columns; // индекс = номер колонки в строке
+        QVector<int> sensorIds;  // слот -> id датчика (S<n>)
+    };
+
+    // threadCount: 0 - по числу ядер, 1 - однопоточный разбор.
+    // control (может быть nullptr): прогресс в байтах и отмена; при отмене возвращает false.
+    // parsedBytes (может быть nullptr): файл еще дописывается - разбираются только целые
+    // строки, сюда пишется смещение, с которого продолжать (см. TailFollower).
+    // storage: колонки больше половины лимита памяти хранятся на диске, со сжатием -
+    // сжатыми кусками в памяти (ChunkStore::forColumns, разбор - parseBufferPaged).
+    static bool parseFile(const QString &txtFilePath, SensorDataset &dataset, int threadCount = 0,
+                          TaskControl *control = nullptr, qint64 *parsedBytes = nullptr,
+                          const ColumnStorageOptions &storage = ColumnStorageOptions());
+
+    // Разбор уже загруженного (или отображенного в память) содержимого файла.
+    // Тело после заголовка режется по границам строк на куски, куски разбираются
+    // параллельно и склеиваются по порядку следования в файле.
+    static bool parseBuffer(const char *begin, const char *end, SensorDataset &dataset, int threadCount = 0,
+                            TaskControl *control = nullptr);
+
+    // То же с колонками в хранилище (на диске или сжатом): тело разбирается сегментами
+    // по ~segmentBytes, колонки каждого сегмента дописываются в store и освобождаются
+    static bool parseBufferPaged(const char *begin, const char *end, SensorDataset &dataset,
+                                 const QSharedPointer<ChunkStore> &store, qint64 segmentBytes, int threadCount = 0,
+                                 TaskControl *control = nullptr);
+
+    // Оценка объема колонок в памяти после разбора (по заголовку и длине первой строки)
+    static qint64 estimateColumnBytes(const char *begin, const char *end);
+
+    // Ищет строку заголовка "Time ... S<n>_A". bodyOffset - начало первой строки данных.
+    static bool parseHeader(const char *begin, const char *end, Layout &layout, qsizetype &bodyOffset);
+
+    // Разбирает строки данных и дописывает их в колонки out (датчики - по слотам из layout).
+    // Колонки получаются плотными: на каждую строку по значению у всех датчиков,
+    // отсутствующие в строке датчики получают gapSample(). Там же каждая строка проходит
+    // через детекторы неисправностей (Sensor::monitorA/B). Возвращает false при отмене.
+    static bool parseRows(const char *begin, const char *end, const Layout &layout, SensorDataset &out,
+                          TaskControl *control = nullptr);
+
+    // Число с десятичной точкой или запятой. Некорректный токен -> 0 (как QString::toDouble)
+    static double parseNumber(const char *begin, const char *end);
+
+    // Конец последней целой строки (сразу за '\n'); begin, если целых строк нет
+    static const char *completeLinesEnd(const char *begin, const char *end);
+
+    // Кусок тела файла, всегда из целых строк
+    struct Chunk {
+        const char *begin = nullptr;
+        const char *end = nullptr;
+    };
+    static QVector<Chunk> splitChunks(const char *begin, const char *end, int threadCount);
+
+    // Тело без заголовка -> плотные колонки по слотам layout (до finalizeSensors)
+    static bool parseBody(const char *body, const char *end, const Layout &layout, SensorDataset &result,
+                          int threadCount, TaskControl *control);
+
+    // Пустые датчики для всех слотов заголовка
+    static QVector<Sensor> makeSensors(const Layout &layout);
+
+    // Обрезает пропуски в начале/конце каждого датчика (начало -> offset),
+    // убирает датчики без точек и сортирует по id
+    static void finalizeSensors(SensorDataset &dataset);
+};
+
+#endif // TXTPARSER_H